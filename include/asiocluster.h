@@ -0,0 +1,277 @@
+#pragma once
+
+#include "asynccluster.h"
+
+// Boost.Asio by default, standalone Asio with REDIS_CLUSTER_STANDALONE_ASIO
+#if defined(REDIS_CLUSTER_STANDALONE_ASIO) && __has_include(<asio.hpp>)
+#include <asio.hpp>
+#define REDIS_CLUSTER_ASIO 1
+namespace RedisClusterAPI
+{
+namespace net = ::asio;
+typedef std::error_code AsioErrorCode;
+} // RedisClusterAPI
+#elif !defined(REDIS_CLUSTER_STANDALONE_ASIO) && __has_include(<boost/asio.hpp>)
+#include <boost/asio.hpp>
+#define REDIS_CLUSTER_ASIO 1
+namespace RedisClusterAPI
+{
+namespace net = boost::asio;
+typedef boost::system::error_code AsioErrorCode;
+} // RedisClusterAPI
+#endif
+
+#ifdef REDIS_CLUSTER_ASIO
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT) || defined(ASIO_HAS_CO_AWAIT)
+#define REDIS_CLUSTER_ASIO_AWAIT 1
+#endif
+
+namespace RedisClusterAPI
+{
+
+typedef net::strand<net::io_context::executor_type> AsioStrand;
+
+// hiredis event hooks of one async context, run on an Asio strand.
+//   Asio waits are one-shot, so a direction hiredis still wants is waited on
+// again after each event. The pending waits share the object, Cleanup() only
+// detaches it from the context, which hiredis closes right after.
+class AsioEvents : public std::enable_shared_from_this<AsioEvents>
+{
+public:
+    AsioEvents(redisAsyncContext *context, const AsioStrand &strand)
+        : _context(context), _socket(strand, context->c.fd), _timer(strand),
+          _reading(false), _writing(false), _readWait(false), _writeWait(false) {}
+    // an AsyncCluster::EventAttachFn, 'loop' is the AsioStrand
+    static int Attach(redisAsyncContext *context, void *loop)
+    {
+        if (context->ev.data != NULL) {
+            return REDIS_ERR;
+        }
+        std::shared_ptr<AsioEvents> *e = new std::shared_ptr<AsioEvents>(
+            std::make_shared<AsioEvents>(context, *(AsioStrand *)loop));
+
+        context->ev.addRead = AddRead;
+        context->ev.delRead = DelRead;
+        context->ev.addWrite = AddWrite;
+        context->ev.delWrite = DelWrite;
+        context->ev.cleanup = Cleanup;
+        context->ev.scheduleTimer = ScheduleTimer;
+        context->ev.data = e;
+        return REDIS_OK;
+    }
+private:
+    static AsioEvents *Get(void *privdata)
+    {
+        return ((std::shared_ptr<AsioEvents> *)privdata)->get();
+    }
+    static void AddRead(void *privdata) { Get(privdata)->_reading = true; Get(privdata)->Wait(false); }
+    static void DelRead(void *privdata) { Get(privdata)->_reading = false; }
+    static void AddWrite(void *privdata) { Get(privdata)->_writing = true; Get(privdata)->Wait(true); }
+    static void DelWrite(void *privdata) { Get(privdata)->_writing = false; }
+    static void ScheduleTimer(void *privdata, struct timeval tv)
+    {
+        AsioEvents *e = Get(privdata);
+        e->_timer.expires_after(std::chrono::seconds(tv.tv_sec) +
+                                std::chrono::microseconds(tv.tv_usec));
+        std::shared_ptr<AsioEvents> self = e->shared_from_this();
+        e->_timer.async_wait([self](const AsioErrorCode &ec) {
+            if (!ec && self->_context) {
+                redisAsyncHandleTimeout(self->_context);
+            }
+        });
+    }
+    static void Cleanup(void *privdata)
+    {
+        std::shared_ptr<AsioEvents> *e = (std::shared_ptr<AsioEvents> *)privdata;
+        (*e)->_context = NULL;
+        (*e)->_timer.cancel();
+        // hiredis owns the fd, the pending waits complete as aborted
+        (*e)->_socket.release();
+        delete e;
+    }
+
+    void Wait(bool write)
+    {
+        bool &waiting = write ? _writeWait : _readWait;
+        if (waiting) {
+            return;
+        }
+        waiting = true;
+        std::shared_ptr<AsioEvents> self = shared_from_this();
+        _socket.async_wait(write ? net::posix::stream_descriptor::wait_write
+                                 : net::posix::stream_descriptor::wait_read,
+                           [self, write](const AsioErrorCode &ec) {
+                               self->OnWait(write, ec);
+                           });
+    }
+    void OnWait(bool write, const AsioErrorCode &ec)
+    {
+        (write ? _writeWait : _readWait) = false;
+        if (ec || _context == NULL || (write ? _writing : _reading) == false) {
+            return;
+        }
+        if (write) {
+            redisAsyncHandleWrite(_context);
+        } else {
+            redisAsyncHandleRead(_context);
+        }
+        // the context is gone if the call freed it
+        if (_context && (write ? _writing : _reading)) {
+            Wait(write);
+        }
+    }
+private:
+    redisAsyncContext *_context;
+    net::posix::stream_descriptor _socket;
+    net::steady_timer _timer;
+    bool _reading;   // wanted by hiredis
+    bool _writing;
+    bool _readWait;  // a wait is pending
+    bool _writeWait;
+};
+
+// One command in flight for an AsioCluster: the Asio handler, the work it
+// keeps on the handler's executor and the arguments, which stay alive until
+// the reply is in since large ones are written from them.
+template<typename Handler>
+class AsioOperation
+{
+public:
+    AsioOperation(Handler &&handler,
+                  const AsioStrand &strand,
+                  std::string &&key,
+                  std::vector<std::string> &&args)
+        : _handler(std::move(handler)),
+          _work(net::make_work_guard(net::get_associated_executor(_handler, strand))),
+          _key(std::move(key)), _args(std::move(args)), _started(false), _done(false) {}
+    // a command the cluster dropped completes as failed
+    ~AsioOperation()
+    {
+        if (_started && _done == false) {
+            Complete(CommandResult());
+        }
+    }
+    AsioOperation(const AsioOperation &) = delete;
+    AsioOperation& operator=(const AsioOperation &) = delete;
+
+    void Complete(CommandResult &&result)
+    {
+        _done = true;
+        net::dispatch(_work.get_executor(),
+                      [handler = std::move(_handler),
+                       result = std::move(result)]() mutable {
+                          std::move(handler)(std::move(result));
+                      });
+        _work.reset();
+    }
+public:
+    Handler _handler;
+    net::executor_work_guard<net::associated_executor_t<Handler, AsioStrand>> _work;
+    std::string _key;
+    std::vector<std::string> _args;
+    bool _started;
+    bool _done;
+};
+
+// AsyncCluster whose node connections run on an application io_context.
+//   The cluster is only used on its strand, so the io_context may be run by
+// any number of threads. The Async*() operations take any completion token
+// of signature void(CommandResult): a callback, net::use_future,
+// net::use_awaitable... A NULL reply means the command failed. They copy the
+// arguments, start on the strand and complete on the executor associated
+// with the handler, the strand by default. Connect() and the destructor must
+// run on the strand, or while the io_context is not running.
+class AsioCluster
+{
+public:
+    typedef AsioStrand executor_type;
+public:
+    AsioCluster(net::io_context &io,
+                const char *ip,
+                int port,
+                int connect_timeout,
+                int command_timeout,
+                AsyncClusterCallback *callback = NULL,
+                bool debug = false)
+        : _strand(net::make_strand(io))
+    {
+        _asyncCluster = new AsyncCluster(ip, port, connect_timeout, command_timeout,
+                                         NULL, callback, debug);
+        _asyncCluster->SetEventLoop(AsioEvents::Attach, &_strand);
+    }
+    ~AsioCluster()
+    {
+        delete _asyncCluster;
+        _asyncCluster = NULL;
+    }
+    AsioCluster(const AsioCluster &) = delete;
+    AsioCluster& operator=(const AsioCluster &) = delete;
+
+    bool Connect() { return _asyncCluster->Connect(); }
+    bool DisConnect() { return _asyncCluster->DisConnect(); }
+
+    template<typename Token>
+    auto AsyncGet(std::string_view key, Token &&token)
+    {
+        std::string_view argv[2] = { "GET", key };
+        return AsyncCommand(key, 2, argv, std::forward<Token>(token));
+    }
+    template<typename Token>
+    auto AsyncSet(std::string_view key, std::string_view val, Token &&token)
+    {
+        std::string_view argv[3] = { "SET", key, val };
+        return AsyncCommand(key, 3, argv, std::forward<Token>(token));
+    }
+    template<typename Token>
+    auto AsyncCommand(std::string_view key,
+                      int argc,
+                      const std::string_view *argv,
+                      Token &&token)
+    {
+        // copied now, a lazy token starts the operation after this returns
+        std::vector<std::string> args(argv, argv + argc);
+        return net::async_initiate<Token, void(CommandResult)>(
+            [this](auto &&handler, std::string key, std::vector<std::string> args) {
+                Start(std::forward<decltype(handler)>(handler), std::move(key), 
+                      std::move(args));
+            }, token, std::string(key), std::move(args));
+    }
+public:
+    executor_type get_executor() { return _strand; }
+    // only to be used on the strand
+    AsyncCluster *GetAsyncCluster() { return _asyncCluster; }
+private:
+    template<typename Handler>
+    void Start(Handler &&handler, std::string &&key, std::vector<std::string> &&args)
+    {
+        typedef AsioOperation<typename std::decay<Handler>::type> Operation;
+        typename std::decay<Handler>::type fn(std::forward<Handler>(handler));
+        std::unique_ptr<Operation> op(new Operation(std::move(fn), _strand,
+                                                    std::move(key), std::move(args)));
+        net::post(_strand, [this, op = std::move(op)]() mutable {
+            Operation *raw = op.get();
+            raw->_started = true;
+            std::vector<std::string_view> args(raw->_args.begin(), raw->_args.end());
+            // the handler owns the operation from here, it is destroyed
+            // without a call if the command is not sent
+            _asyncCluster->CommandArgv(raw->_key, (int)args.size(), args.data(),
+                [op = std::move(op)](RetainedReply *reply) mutable {
+                    op->Complete(CommandResult(reply));
+                });
+        });
+    }
+private:
+    AsioStrand _strand;
+    AsyncCluster *_asyncCluster;
+};
+
+} // RedisClusterAPI
+
+#endif
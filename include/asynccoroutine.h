@@ -0,0 +1,152 @@
+#pragma once
+
+#include "asynccluster.h"
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#include <coroutine>
+#include <exception>
+#include <string_view>
+
+#define REDIS_CLUSTER_COROUTINE 1
+
+namespace RedisClusterAPI
+{
+
+// Awaitable command, sent through CommandArgv() with itself as the callback.
+//   It lives in the coroutine frame until the reply is in, so neither the
+// arguments nor a context are copied to the heap. The coroutine is resumed
+// on the loop thread from the reply callback, which rules out
+// SetCallbackExecutor() on the same cluster. Values are sent and returned as
+// they are, the compressor is not applied.
+class CommandAwaiter : public AsyncClusterCallback
+{
+public:
+    CommandAwaiter(AsyncCluster *asyncCluster,
+                   std::string_view key,
+                   int argc,
+                   const std::string_view *argv)
+        : _asyncCluster(asyncCluster), _key(key), _argc(argc), _argv(argv) {}
+    CommandAwaiter(AsyncCluster *asyncCluster,
+                   std::string_view name,
+                   std::string_view key)
+        : _asyncCluster(asyncCluster), _key(key), _argc(2), _argv(_args)
+    {
+        _args[0] = name;
+        _args[1] = key;
+    }
+    CommandAwaiter(AsyncCluster *asyncCluster,
+                   std::string_view name,
+                   std::string_view key,
+                   std::string_view value)
+        : _asyncCluster(asyncCluster), _key(key), _argc(3), _argv(_args)
+    {
+        _args[0] = name;
+        _args[1] = key;
+        _args[2] = value;
+    }
+    CommandAwaiter(const CommandAwaiter &) = delete;
+    CommandAwaiter& operator=(const CommandAwaiter &) = delete;
+
+    bool await_ready() { return false; }
+    // resumes right away with an empty result if the command is not sent
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        _handle = handle;
+        return _asyncCluster->CommandArgv(_key, NULL, _argc, _argv, this);
+    }
+    CommandResult await_resume() { return std::move(_result); }
+public:
+    virtual void OnConnect(const redisAsyncContext *, int) {}
+    virtual void OnDisconnect(const redisAsyncContext *, int) {}
+    virtual void OnCommand(redisReply *reply, void *, void *)
+    {
+        if (reply) {
+            _result = CommandResult(_asyncCluster->RetainReply(reply));
+        }
+        // the frame, and this awaiter with it, may be gone once it returns
+        _handle.resume();
+    }
+private:
+    AsyncCluster *_asyncCluster;
+    std::string_view _key;
+    int _argc;
+    const std::string_view *_argv;
+    std::string_view _args[3];
+    std::coroutine_handle<> _handle;
+    CommandResult _result;
+};
+
+inline CommandAwaiter AwaitGet(AsyncCluster &asyncCluster, std::string_view key)
+{
+    return CommandAwaiter(&asyncCluster, "GET", key);
+}
+
+inline CommandAwaiter AwaitSet(AsyncCluster &asyncCluster,
+                               std::string_view key,
+                               std::string_view value)
+{
+    return CommandAwaiter(&asyncCluster, "SET", key, value);
+}
+
+// 'argv' must stay valid until the co_await completes
+inline CommandAwaiter AwaitCommand(AsyncCluster &asyncCluster,
+                                   std::string_view key,
+                                   int argc,
+                                   const std::string_view *argv)
+{
+    return CommandAwaiter(&asyncCluster, key, argc, argv);
+}
+
+// Fire-and-forget coroutine running on the event loop of an AsyncCluster.
+//   It starts right away and frees itself when it returns. When its first
+// parameter is the AsyncCluster (by reference), the frame is taken from the
+// FramePool of that cluster, so the cluster must outlive the task.
+class ClusterTask
+{
+public:
+    struct promise_type
+    {
+        ClusterTask get_return_object() { return ClusterTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        template<typename... Args>
+        static void *operator new(size_t size, AsyncCluster &asyncCluster, Args &&...)
+        {
+            return Allocate(asyncCluster.GetFramePool(), size);
+        }
+        static void *operator new(size_t size) { return Allocate(NULL, size); }
+        static void operator delete(void *ptr, size_t size)
+        {
+            FrameHeader *header = (FrameHeader *)ptr - 1;
+            if (header->pool) {
+                header->pool->Free(header, size + sizeof(FrameHeader));
+            } else {
+                free(header);
+            }
+        }
+    };
+private:
+    // keeps the frame aligned for new, and tells delete where it came from
+    struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) FrameHeader
+    {
+        FramePool *pool;
+    };
+private:
+    static void *Allocate(FramePool *pool, size_t size)
+    {
+        size += sizeof(FrameHeader);
+        FrameHeader *header = (FrameHeader *)(pool ? pool->Allocate(size) : malloc(size));
+        if (header == NULL) {
+            throw std::bad_alloc();
+        }
+        header->pool = pool;
+        return header + 1;
+    }
+};
+
+} // RedisClusterAPI
+
+#endif
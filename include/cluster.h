@@ -3,12 +3,19 @@
 
 #include <string.h>
 #include <string>
+#include <string_view>
 #include <map>
 #include <stdarg.h>
+#include <memory_resource>
 
 #include "slothash.h"
 #include "clustertypelist.h"
 #include "clusterpool.h"
+#include "argvcommand.h"
+#include "respcommand.h"
+#include "respreader.h"
+#include "valuesink.h"
+#include "valuecodec.h"
 
 namespace RedisClusterAPI
 {
@@ -42,17 +49,104 @@ public:
     bool PingALL();
     bool Set(const char *key, const char *val);
     bool Get(const char *key, std::string &output);
+    bool Set(std::string_view key, std::string_view val);
+    bool Get(std::string_view key, std::string &output);
+    bool Get(std::string_view key, char *buf, size_t size, size_t *len);
+    bool Get(std::string_view key, std::pmr::string &output);
+    bool Get(std::string_view key, ValueCallback *callback, void *privdata = NULL);
+    template<typename T, typename = EnableIfTyped<T>>
+    bool Set(std::string_view key, const T &val);
+    template<typename T, typename = EnableIfTyped<T>>
+    bool Get(std::string_view key, T &output);
+    redisReply *CommandArgv(std::string_view key, int argc, const std::string_view *argv);
 public:
+    void SetRespReader(bool enable) { _respReader = enable; }
+    // set before Connect(), routes against the process-wide topology
+    void SetSharedTopology(bool enable) { _sharedTopology = enable; }
+    void SetCompressor(ValueCompressor *compressor) { _compressor = compressor; }
+    ValueCompressor *GetCompressor() { return _compressor; }
     SyncClusterPool *GetPool() { return _pool; }
     static int processReply(const redisReply *reply, const char *&ip, int &port);
+    static bool SendArgvCommand(redisContext *context, ArgvCommand *argv);
 private:
     redisReply *Command(std::string key, const char *format, ...);
-    void DoneCommand(std::string key, const char *format, va_list ap, redisReply **reply);
+    redisReply *FormattedCommand(std::string key, const char *cmd, int cmdlen);
+    void DoneCommand(std::string key, const char *cmd, int cmdlen, redisReply **reply);
+    redisReply *CommandArgv(std::string_view key, int argc, 
+                            const std::string_view *argv, ValueSink *sink);
+    redisReply *Ask(const char *ip, int port, const char *cmd, int cmdlen, 
+                    ArgvCommand *argv, ValueSink *sink);
+    void ResetContext(ClusterNode *node);
+    int GetReply(redisContext *context, redisReply **reply, ValueSink *sink = NULL);
+    static void CopyToBuffer(std::string_view value, void *buffer);
+    static void CopyToString(std::string_view value, void *output);
+    static void DecodeValue(std::string_view value, void *decoded);
+    bool AssignValue(const redisReply *reply, std::string &output);
+    template<typename T>
+    static void ReadTyped(std::string_view value, void *output);
 private:
     SyncClusterPool *_pool;
     char _ip[32];
 	int _port;
     bool _debug;
+    bool _respReader;
+    bool _sharedTopology;
+    ValueCompressor *_compressor;
 };
 
+struct DecodedValue
+{
+    ValueCallback *callback;
+    void *privdata;
+    ValueCompressor *compressor;
+    bool failed;
+};
+
+template<typename T>
+struct TypedOutput
+{
+    T *value;
+    bool read;
+};
+
+template<typename T, typename>
+bool Cluster::Set(std::string_view key, const T &val)
+{
+    // the codec needs the whole value, serialized aside
+    if (_compressor) {
+        std::string value(ValueTraits<T>::Size(val), '\0');
+        ValueTraits<T>::Write(&value[0], val);
+        return Set(key, std::string_view(value));
+    }
+
+    char *cmd;
+    int cmdlen = RespSet::FormatValue(&cmd, &key, val);
+    if (cmdlen < 0) {
+        return false;
+    }
+    redisReply *reply = FormattedCommand(std::string(key), cmd, cmdlen);
+    free(cmd);
+    if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
+        freeReplyObject(reply);
+        return false;
+    }
+    freeReplyObject(reply);
+    return true;
+}
+
+// fails on a nil reply or on bytes ValueTraits<T> cannot read
+template<typename T, typename>
+bool Cluster::Get(std::string_view key, T &output)
+{
+    TypedOutput<T> typed = { &output, false };
+    return Get(key, ReadTyped<T>, &typed) && typed.read;
+}
+
+template<typename T>
+void Cluster::ReadTyped(std::string_view value, void *output)
+{
+    TypedOutput<T> *typed = (TypedOutput<T> *)output;
+    typed->read = ValueTraits<T>::Read(value, *typed->value);
+}
+
 } // RedisClusterAPI
\ No newline at end of file
@@ -3,7 +3,9 @@
 #include <iostream>
 #include <async.h>
 #include <hiredis.h>
+#include <string.h>
 #include <map>
+#include <vector>
 
 namespace RedisClusterAPI
 {
@@ -23,25 +25,50 @@ public:
     typedef void (CommandCallbackFn)(redisReply *reply, void *self, void *data);
     typedef void (ConnectCallbackFn)(const redisAsyncContext *context, int status);
     typedef void (DisconnectCallbackFn)(const redisAsyncContext *context, int status);
-    typedef Context *(ConnectFn)(const char *ip, int port);
-    typedef void (FreeConnectFn)(Context *context);
 
     class ClusterNodeData 
     {
     public:
         ClusterNodeData() = default;
         ClusterNodeData(bool is_connected, const char *IP, int port, const char *ID, Context *ctx)
-            : connected(is_connected), port(port), context(ctx), failureCount(0)
+            : connected(is_connected), port(port), context(ctx), laneCount(1), 
+              failureCount(0)
         { 
-            strncpy(ip, IP, 16);
+            strncpy(ip, IP, sizeof(ip) - 1);
+            ip[sizeof(ip) - 1] = '\0';
             strncpy(id, ID, 41);
         }
+        // connection of the slot within the lane, a slot always maps to the 
+        // same one
+        Context *GetStripe(Slot index, uint32_t lane = 0) const
+        {
+            if (stripes.empty()) {
+                return context;
+            }
+            size_t perLane = (stripes.size() + 1) / laneCount;
+            size_t stripe = (lane % laneCount) * perLane + index % perLane;
+            return stripe == 0 ? context : stripes[stripe - 1];
+        }
+        bool HasContext(const Context *ctx) const
+        {
+            if (ctx == context) {
+                return true;
+            }
+            for (size_t i = 0; i < stripes.size(); i++) {
+                if (ctx == stripes[i]) {
+                    return true;
+                }
+            }
+            return false;
+        }
     public:
         bool connected;
-        char ip[16];
+        char ip[46];
         int port;
         char id[41];
         Context *context;
+        std::vector<Context *> stripes; // connections after 'context'
+        uint32_t laneCount;             // all connections split in lanes
         uint32_t failureCount;
     };
 
@@ -71,4 +98,19 @@ enum UpdatePoolType {
     UPDATE_UNCHANGED
 };
 
+enum CommandResultType {
+    COMMAND_OK = 150,
+    COMMAND_FAILED,
+    COMMAND_QUEUEFULL
+};
+
+#define PRIORITY_COUNT 2
+
+// Lanes of a command. With SetPriorityLanes(), each lane has its own 
+// connections to every node, and each lane always has its own flow control.
+enum CommandPriority {
+    PRIORITY_INTERACTIVE = 0,   // default, latency-sensitive commands
+    PRIORITY_BULK               // batch loads, kept off the interactive lane
+};
+
 } // RedisClusterAPI
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+#include <hiredis.h>
+
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <map>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+#include "slothash.h"
+#include "clustertypelist.h"
+#include "sharedtopology.h"
+#include "nodeconnections.h"
+#include "argvcommand.h"
+#include "valuesink.h"
+
+namespace RedisClusterAPI
+{
+
+// Thread-safe sync cluster client, one instance shared by every thread.
+//   Commands are routed through a slot table to the NodeConnections of the
+// master, whose connections are checked out for the command and returned
+// after it, so threads only meet on the same connection slots. The slot
+// table is an immutable snapshot read without a lock under an EpochGuard, 
+// like SharedTopology. The first thread that sees a failure or a MOVED 
+// builds and publishes a new table, the others retry on it instead of 
+// refreshing again and never wait for the CLUSTER SLOTS of the refresh. An
+// ASK is followed once, with ASKING on a connection of the importing node.
+class ConcurrentCluster : public ClusterTypeList<redisContext>
+{
+public:
+    typedef std::map<std::string, NodeConnections *> NodeMap;
+    static const int SLOTCOUNT = 16384;
+    // immutable once published, the nodes outlive it
+    struct SlotTable {
+        uint64_t version;
+        uint64_t topologyVersion;           // of the shared topology behind it
+        NodeConnections *slots[SLOTCOUNT];
+    };
+public:
+    ConcurrentCluster(const char *ip,
+                      int port,
+                      int maxConnections,
+                      int connect_timeout,
+                      int command_timeout,
+                      bool debug = false);
+    ~ConcurrentCluster();
+    ConcurrentCluster(const ConcurrentCluster &) = delete;
+    ConcurrentCluster& operator=(const ConcurrentCluster &) = delete;
+
+    bool Connect();
+    bool Set(std::string_view key, std::string_view val);
+    bool Get(std::string_view key, std::string &output);
+    bool Get(std::string_view key, ValueCallback *callback, void *privdata = NULL);
+    redisReply *CommandArgv(std::string_view key, int argc, const std::string_view *argv);
+public:
+    // set before Connect(), the reader of a connection is chosen once
+    void SetRespReader(bool enable) { _respReader = enable; }
+    // set before Connect(), routes against the process-wide topology
+    void SetSharedTopology(bool enable) { _sharedTopology = enable; }
+    void GetStats(std::vector<NodeConnectionStats> &stats);
+    void PrintStats();
+    uint64_t GetRefreshCount() { return _refreshCount.load(std::memory_order_relaxed); }
+private:
+    redisReply *CommandArgv(std::string_view key, int argc,
+                            const std::string_view *argv, ValueSink *sink);
+    redisReply *Ask(const char *ip, int port, ArgvCommand *argv, ValueSink *sink);
+    NodeConnections *GetNodeBySlot(Slot index, uint64_t *version, bool *stale);
+    NodeConnections *GetNode(const char *ip, int port);
+    bool Refresh(uint64_t version);
+    UpdatePoolType FetchTopology(std::vector<TopologyNode> &nodes);
+    bool BuildSlots(const std::vector<TopologyNode> &nodes);
+    void Reclaim();
+    int GetReply(redisContext *context, redisReply **reply, ValueSink *sink);
+private:
+    struct Retired {
+        SlotTable *table;
+        uint64_t epoch;
+    };
+
+    SharedTopology *_topology;
+    std::atomic<SlotTable *> _table;
+    NodeMap *_nodes;                       // never shrinks, nodes outlive the tables
+    std::mutex _nodesLock;                 // guards _nodes, never held over I/O
+    std::mutex _refreshLock;               // one refresh at a time, readers never take it
+    uint64_t _topologyVersion;             // guarded by _refreshLock
+    std::vector<TopologyNode> *_masters;   // same, behind the table, the refresh seeds
+    std::recursive_mutex _retireLock;      // also taken by readers without an epoch record
+    std::vector<Retired> *_retired;        // guarded by _retireLock
+    std::atomic<uint64_t> _refreshCount;
+    char _ip[32];
+    int _port;
+    int _maxConnections;
+    int _connect_timeout;
+    int _command_timeout;
+    bool _debug;
+    bool _respReader;
+    bool _sharedTopology;
+};
+
+} // RedisClusterAPI
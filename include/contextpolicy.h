@@ -0,0 +1,73 @@
+#pragma once
+
+#include <hiredis.h>
+#include <async.h>
+
+#include <string.h>
+#include <sys/time.h>
+
+namespace RedisClusterAPI
+{
+
+// Compile-time connection policy of a ClusterPool. Each specialization
+// resolves connect, free and option setup of its context type statically,
+// so the pool never calls hiredis through casted function pointers.
+template <typename CONTEXT>
+struct ContextPolicy;
+
+// Shared option setup. Timeouts are in seconds, zero or less means none.
+struct ContextOptions
+{
+    redisOptions options;
+    struct timeval connectTimeout;
+    struct timeval commandTimeout;
+
+    ContextOptions(const char *ip, int port, int connect_timeout, int command_timeout)
+    {
+        memset(&options, 0, sizeof(options));
+        REDIS_OPTIONS_SET_TCP(&options, ip, port);
+        connectTimeout = {connect_timeout, 0};
+        commandTimeout = {command_timeout, 0};
+        if (connect_timeout > 0) {
+            options.connect_timeout = &connectTimeout;
+        }
+        if (command_timeout > 0) {
+            options.command_timeout = &commandTimeout;
+        }
+    }
+
+    ContextOptions(const ContextOptions &) = delete;
+    ContextOptions &operator=(const ContextOptions &) = delete;
+};
+
+template <>
+struct ContextPolicy<redisContext>
+{
+    static inline redisContext *Connect(ContextOptions &opts)
+    {
+        return redisConnectWithOptions(&opts.options);
+    }
+
+    static inline void Free(redisContext *context)
+    {
+        redisFree(context);
+    }
+};
+
+template <>
+struct ContextPolicy<redisAsyncContext>
+{
+    // a non-blocking connect, the connect timeout is armed on the event
+    // loop once the context is attached
+    static inline redisAsyncContext *Connect(ContextOptions &opts)
+    {
+        return redisAsyncConnectWithOptions(&opts.options);
+    }
+
+    static inline void Free(redisAsyncContext *context)
+    {
+        redisAsyncFree(context);
+    }
+};
+
+} // RedisClusterAPI
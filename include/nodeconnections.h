@@ -0,0 +1,77 @@
+#pragma once
+#include <hiredis.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "contextpolicy.h"
+
+namespace RedisClusterAPI
+{
+
+struct NodeConnectionStats
+{
+    std::string ip;
+    int port;
+    int created;           // open connections, idle or checked out
+    int maxConnections;
+    uint64_t checkouts;
+    uint64_t waits;        // checkouts that found the node at its cap
+    uint64_t waitTimeouts;
+    uint64_t waitNsec;     // total time spent waiting
+    uint64_t maxWaitNsec;
+    uint64_t connectFailures;
+};
+
+// Bounded set of blocking connections to one node, shared by threads.
+//   Idle connections sit in a fixed array of atomic slots: Checkout() takes
+// one with an exchange and Return() puts it back with a compare-exchange, so
+// the fast path takes no lock. A new connection is opened while the node is
+// under 'maxConnections'; past the cap the caller waits for a Return(), up to
+// the command timeout. Only that slow path uses the mutex.
+class NodeConnections
+{
+public:
+    NodeConnections(const char *ip,
+                    int port,
+                    int maxConnections,
+                    int connect_timeout,
+                    int command_timeout);
+    ~NodeConnections();
+    NodeConnections(const NodeConnections &) = delete;
+    NodeConnections& operator=(const NodeConnections &) = delete;
+
+    redisContext *Checkout();
+    void Return(redisContext *context, bool broken = false);
+    void GetStats(NodeConnectionStats &stats);
+public:
+    const char *GetIP() { return _ip.c_str(); }
+    int GetPort() { return _port; }
+private:
+    redisContext *TryTake();
+    redisContext *TryConnect(bool *capped);
+    void Wakeup();
+private:
+    std::atomic<redisContext *> *_idle;
+    std::atomic<int> _created;
+    std::atomic<int> _waiters;
+    std::mutex _waitLock;
+    std::condition_variable _waitCond;
+    std::atomic<uint64_t> _checkouts;
+    std::atomic<uint64_t> _waits;
+    std::atomic<uint64_t> _waitTimeouts;
+    std::atomic<uint64_t> _waitNsec;
+    std::atomic<uint64_t> _maxWaitNsec;
+    std::atomic<uint64_t> _connectFailures;
+    std::string _ip;       // a hostname or an IPv6 address
+    int _port;
+    int _maxConnections;
+    int _connect_timeout;
+    int _command_timeout;
+};
+
+} // RedisClusterAPI
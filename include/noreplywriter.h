@@ -0,0 +1,91 @@
+#pragma once
+#include <hiredis.h>
+#include <async.h>
+#include <event2/event.h>
+
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <map>
+#include <stdarg.h>
+#include <stdint.h>
+
+#include "asynccluster.h"
+
+namespace RedisClusterAPI
+{
+
+// Fire-and-forget writes on dedicated per-node connections.
+//   Every connection runs with 'CLIENT REPLY OFF', so the server sends no 
+// reply for the written commands and nothing is parsed on the client side. 
+// Every 'checkpoint_interval' ms or 'checkpoint_count' commands, each 
+// connection is fenced with 'CLIENT REPLY ON' + 'EXISTS <last written key>'
+// (or 'PING' if nothing was written); its reply confirms that every command 
+// written before it has been processed by the server.
+//   A checkpoint only proves delivery, not success: the error of a rejected 
+// command (WRONGTYPE, OOM, ...) is never sent back. A MOVED or ASK reply to 
+// the fence tells the slot of the sampled key has left the node; the writes 
+// behind that checkpoint are counted as lost, and on MOVED the topology of 
+// the cluster is refreshed so later writes go to the new owner. Commands 
+// written after the last confirmed checkpoint of a connection which gets 
+// disconnected are lost as well, see GetLostCount().
+class NoReplyWriter : public ClusterTypeList<redisAsyncContext>
+{
+public:
+    struct NoReplyConnection {
+        NoReplyConnection() 
+            : context(NULL), writer(NULL), sent(0), confirmed(0), 
+              sinceCheckpoint(0) {}
+        redisAsyncContext *context;
+        NoReplyWriter *writer;
+        uint64_t sent;             // commands written on this connection
+        uint64_t confirmed;        // commands fenced by the last checkpoint
+        uint32_t sinceCheckpoint;
+        std::string lastKey;       // sampled by the next checkpoint
+    };
+    struct CheckpointData {
+        CheckpointData(NoReplyConnection *c, uint64_t s) : conn(c), sent(s) {}
+        NoReplyConnection *conn;
+        uint64_t sent;
+    };
+    typedef std::map<std::string, NoReplyConnection *> ConnectionMap;
+public:
+    NoReplyWriter(AsyncCluster *asyncCluster, 
+                  int checkpoint_interval, 
+                  uint32_t checkpoint_count);
+    ~NoReplyWriter();
+    NoReplyWriter(const NoReplyWriter &) = delete;
+    NoReplyWriter& operator=(const NoReplyWriter &) = delete;
+
+    bool Set(std::string_view key, std::string_view val);
+    bool Command(std::string key, const char *format, ...);
+    bool CommandArgv(std::string_view key, int argc, const std::string_view *argv);
+    int Checkpoint();
+public:
+    uint64_t GetSentCount() { return _sent; }
+    uint64_t GetConfirmedCount() { return _confirmed; }
+    uint64_t GetLostCount() { return _lost; }
+    // checkpoints answered with MOVED or ASK
+    uint64_t GetMovedCount() { return _moved; }
+private:
+    bool Append(const std::string &key, char *cmd, int cmdlen);
+    NoReplyConnection *GetConnection(const std::string &key);
+    NoReplyConnection *GetConnectionByCtx(const redisAsyncContext *context);
+    bool Checkpoint(NoReplyConnection *conn);
+    static void ArmWrite(redisAsyncContext *context);
+    static void OnCheckpoint(redisAsyncContext *context, void *reply, void *privdata);
+    static void OnConnect(const redisAsyncContext *context, int status);
+    static void OnDisconnect(const redisAsyncContext *context, int status);
+    static void OnCheckpointTimer(evutil_socket_t fd, short what, void *arg);
+private:
+    AsyncCluster *_asyncCluster;
+    ConnectionMap *_connections;
+    struct event *_timer;
+    uint32_t _checkpoint_count;
+    uint64_t _sent;
+    uint64_t _confirmed;
+    uint64_t _lost;
+    uint64_t _moved;
+};
+
+} // RedisClusterAPI
@@ -0,0 +1,104 @@
+#pragma once
+#include <hiredis.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+namespace RedisClusterAPI
+{
+
+class RetainedReply;
+
+// Per-connection arena holding the whole redisReply tree of one reply.
+//   Plugged into the hiredis reader through redisReplyObjectFunctions: every 
+// node, string and element array of a reply is bump-allocated from the arena
+// and nothing is freed one by one. The arena is reset once the reply has been
+// handled, so the reply must not be used after its callback returns, unless 
+// it has been retained with Retain().
+class ReplyArena
+{
+public:
+    ReplyArena(size_t chunkSize = DEFAULT_CHUNK_SIZE);
+    ~ReplyArena();
+    ReplyArena(const ReplyArena &) = delete;
+    ReplyArena& operator=(const ReplyArena &) = delete;
+
+    void *Allocate(size_t size);
+    void Reset();
+    RetainedReply *Retain(redisReply *reply);
+    void Attach(redisContext *context);
+    static RetainedReply *Copy(const redisReply *reply);
+public:
+    uint64_t GetChunkAllocCount() { return _chunkAllocs; }
+    static bool IsAttached(const redisContext *context);
+    static ReplyArena *GetArena(const redisContext *context);
+    static redisReplyObjectFunctions *GetFunctions() { return &_functions; }
+public:
+    static const size_t DEFAULT_CHUNK_SIZE = 16 * 1024;
+public:
+    struct Chunk {
+        Chunk *next;
+        size_t size;
+        size_t used;
+        char *data() { return (char *)(this + 1); }
+    };
+private:
+    Chunk *NewChunk(size_t size);
+    redisReply *CopyReply(const redisReply *reply);
+    static redisReply *CreateReply(const redisReadTask *task);
+    static void *CreateString(const redisReadTask *task, char *str, size_t len);
+    static void *CreateArray(const redisReadTask *task, size_t elements);
+    static void *CreateInteger(const redisReadTask *task, long long value);
+    static void *CreateDouble(const redisReadTask *task, double value, 
+                              char *str, size_t len);
+    static void *CreateNil(const redisReadTask *task);
+    static void *CreateBool(const redisReadTask *task, int bval);
+    static void FreeObject(void *reply);
+private:
+    Chunk *_chunks;      // current chunk first
+    size_t _chunkSize;
+    uint64_t _chunkAllocs;
+    static redisReplyObjectFunctions _functions;
+};
+
+// Publishes the arena in '*current' for the scope of a reply callback and
+// resets it when leaving.
+class ReplyArenaScope
+{
+public:
+    ReplyArenaScope(ReplyArena *arena, ReplyArena **current) 
+        : _arena(arena), _current(current) 
+    {
+        *_current = _arena;
+    }
+    ~ReplyArenaScope() 
+    {
+        *_current = NULL;
+        if (_arena) {
+            _arena->Reset();
+        }
+    }
+    ReplyArenaScope(const ReplyArenaScope &) = delete;
+    ReplyArenaScope& operator=(const ReplyArenaScope &) = delete;
+private:
+    ReplyArena *_arena;
+    ReplyArena **_current;
+};
+
+// A reply kept past its callback, owns the arena chunks it lives in.
+class RetainedReply
+{
+public:
+    RetainedReply(redisReply *reply, ReplyArena::Chunk *chunks);
+    ~RetainedReply();
+    RetainedReply(const RetainedReply &) = delete;
+    RetainedReply& operator=(const RetainedReply &) = delete;
+
+    redisReply *GetReply() { return _reply; }
+private:
+    redisReply *_reply;
+    ReplyArena::Chunk *_chunks;
+};
+
+} // RedisClusterAPI
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+#include "valuetraits.h"
+
+namespace RedisClusterAPI
+{
+
+// RESP encoding of a command whose name and arity are known at compile time.
+//   The "*<argc>\r\n$<len>\r\n<NAME>\r\n" prefix is built by the compiler, only
+// the length headers and the bytes of the arguments are written at runtime 
+// into a buffer sized exactly once. Shapes are declared with 
+// REDIS_RESP_COMMAND() below.
+template<typename NAME, int ARGC>
+class RespCommand
+{
+public:
+    struct Prefix {
+        char data[64];
+        size_t len;
+    };
+    static constexpr size_t NAMELEN = sizeof(NAME::value) - 1;
+    static_assert(ARGC > 0, "commands without argument are not supported");
+    static_assert(NAMELEN > 0 && NAMELEN < 40, "command name too long");
+public:
+    // exact length of the encoded command
+    static size_t Length(const std::string_view *argv)
+    {
+        size_t len = PREFIX.len;
+        for (int i = 0; i < ARGC; i++) {
+            len += 1 + Digits(argv[i].size()) + 2 + argv[i].size() + 2;
+        }
+        return len;
+    }
+
+    // 'buf' must hold Length(argv) bytes, returns the bytes written
+    static size_t Write(char *buf, const std::string_view *argv)
+    {
+        return WriteArgs(buf, argv, ARGC) - buf;
+    }
+
+    // same contract as redisFormatCommand(): the result is freed with free()
+    static int FormatArgv(char **target, const std::string_view *argv)
+    {
+        size_t len = Length(argv);
+        char *cmd = (char *)malloc(len + 1);
+        if (cmd == NULL) {
+            return -1;
+        }
+        Write(cmd, argv);
+        cmd[len] = '\0';
+        *target = cmd;
+        return (int)len;
+    }
+
+    template<typename... ARGS>
+    static int Format(char **target, ARGS... args)
+    {
+        static_assert(sizeof...(ARGS) == ARGC, "wrong number of arguments");
+        std::string_view argv[ARGC] = { std::string_view(args)... };
+        return FormatArgv(target, argv);
+    }
+
+    // 'argv' holds the first ARGC - 1 arguments, the last one is serialized 
+    // by ValueTraits<T> in place
+    template<typename T>
+    static int FormatValue(char **target, const std::string_view *argv, const T &value)
+    {
+        size_t vlen = ValueTraits<T>::Size(value);
+        size_t len = PREFIX.len + 1 + Digits(vlen) + 2 + vlen + 2;
+        for (int i = 0; i < ARGC - 1; i++) {
+            len += 1 + Digits(argv[i].size()) + 2 + argv[i].size() + 2;
+        }
+
+        char *cmd = (char *)malloc(len + 1);
+        if (cmd == NULL) {
+            return -1;
+        }
+        char *p = WriteArgs(cmd, argv, ARGC - 1);
+        *p++ = '$';
+        p = WriteDigits(p, vlen);
+        *p++ = '\r';
+        *p++ = '\n';
+        p += ValueTraits<T>::Write(p, value);
+        *p++ = '\r';
+        *p++ = '\n';
+        *p = '\0';
+        *target = cmd;
+        return (int)len;
+    }
+public:
+    static constexpr size_t Digits(size_t v)
+    {
+        size_t n = 1;
+        while (v >= 10) {
+            v /= 10;
+            n++;
+        }
+        return n;
+    }
+
+    static char *WriteDigits(char *p, size_t v)
+    {
+        size_t n = Digits(v);
+        for (size_t i = n; i > 0; i--) {
+            p[i - 1] = '0' + (v % 10);
+            v /= 10;
+        }
+        return p + n;
+    }
+private:
+    static char *WriteArgs(char *p, const std::string_view *argv, int argc)
+    {
+        memcpy(p, PREFIX.data, PREFIX.len);
+        p += PREFIX.len;
+
+        for (int i = 0; i < argc; i++) {
+            *p++ = '$';
+            p = WriteDigits(p, argv[i].size());
+            *p++ = '\r';
+            *p++ = '\n';
+            memcpy(p, argv[i].data(), argv[i].size());
+            p += argv[i].size();
+            *p++ = '\r';
+            *p++ = '\n';
+        }
+        return p;
+    }
+
+    static constexpr size_t AppendDigits(char *data, size_t i, size_t v)
+    {
+        size_t n = Digits(v);
+        for (size_t k = n; k > 0; k--) {
+            data[i + k - 1] = '0' + (v % 10);
+            v /= 10;
+        }
+        return i + n;
+    }
+
+    static constexpr Prefix MakePrefix()
+    {
+        Prefix prefix = {};
+        size_t i = 0;
+
+        prefix.data[i++] = '*';
+        i = AppendDigits(prefix.data, i, ARGC + 1);
+        prefix.data[i++] = '\r';
+        prefix.data[i++] = '\n';
+        prefix.data[i++] = '$';
+        i = AppendDigits(prefix.data, i, NAMELEN);
+        prefix.data[i++] = '\r';
+        prefix.data[i++] = '\n';
+        for (size_t k = 0; k < NAMELEN; k++) {
+            prefix.data[i++] = NAME::value[k];
+        }
+        prefix.data[i++] = '\r';
+        prefix.data[i++] = '\n';
+
+        prefix.len = i;
+        return prefix;
+    }
+public:
+    static constexpr Prefix PREFIX = MakePrefix();
+};
+
+#define REDIS_RESP_COMMAND(TYPE, NAME, ARGC)                                  \
+    struct TYPE##Name { static constexpr const char value[] = NAME; };        \
+    typedef RespCommand<TYPE##Name, ARGC> TYPE
+
+REDIS_RESP_COMMAND(RespGet,     "GET",     1);
+REDIS_RESP_COMMAND(RespSet,     "SET",     2);
+REDIS_RESP_COMMAND(RespDel,     "DEL",     1);
+REDIS_RESP_COMMAND(RespIncrBy,  "INCRBY",  2);
+REDIS_RESP_COMMAND(RespHGet,    "HGET",    2);
+REDIS_RESP_COMMAND(RespHSet,    "HSET",    3);
+REDIS_RESP_COMMAND(RespHIncrBy, "HINCRBY", 3);
+REDIS_RESP_COMMAND(RespZAdd,    "ZADD",    3);
+
+} // RedisClusterAPI
@@ -0,0 +1,70 @@
+#pragma once
+#include <hiredis.h>
+#include <async.h>
+#include <event2/event.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+
+namespace RedisClusterAPI
+{
+
+// RESP2/RESP3 reply reader, a drop-in replacement of the hiredis redisReader.
+//   Same protocol coverage, same validation and same reply objects (built 
+// through the redisReplyObjectFunctions of the hiredis reader, so replies are
+// freed with freeReplyObject() or live in a ReplyArena). CRLF is searched 
+// with SSE2/AVX2, bulk payloads are skipped by length without scanning, and 
+// parsing is incremental: a large array is never parsed twice when it spans 
+// several reads.
+class RespReader
+{
+public:
+    RespReader(redisReplyObjectFunctions *fn = NULL, void *privdata = NULL);
+    ~RespReader();
+    RespReader(const RespReader &) = delete;
+    RespReader& operator=(const RespReader &) = delete;
+
+    int Feed(const char *buf, size_t len);
+    char *Reserve(size_t len);
+    void Commit(size_t len);
+    int GetReply(void **reply);
+    void SetFunctions(redisReplyObjectFunctions *fn, void *privdata);
+public:
+    int GetError() { return _err; }
+    const char *GetErrorStr() { return _errstr; }
+    redisReplyObjectFunctions *GetFunctions() { return _fn; }
+    static redisReplyObjectFunctions *DefaultFunctions();
+    static const char *FindCRLF(const char *p, const char *end);
+    static int ParseInteger(const char *p, size_t len, long long *value);
+public:
+    // sync contexts: replaces redisGetReply()
+    static RespReader *Attach(redisContext *context);
+    static int GetReply(redisContext *context, void **reply);
+    // async contexts: replaces redisLibeventAttach()
+    static int LibeventAttach(redisAsyncContext *context, struct event_base *base);
+private:
+    int ProcessItem();
+    int ProcessLineItem(redisReadTask *cur);
+    int ProcessBulkItem(redisReadTask *cur);
+    int ProcessAggregateItem(redisReadTask *cur);
+    void MoveToNextTask();
+    void SetError(int type, const char *str);
+    const char *ReadLine(size_t *len);
+private:
+    char *_buf;
+    size_t _pos;
+    size_t _len;
+    size_t _cap;
+    std::vector<redisReadTask *> _tasks;
+    int _ridx;
+    void *_reply;
+    int _err;
+    char _errstr[128];
+    long long _maxelements;
+    redisReplyObjectFunctions *_fn;
+    void *_privdata;
+};
+
+} // RedisClusterAPI
@@ -0,0 +1,78 @@
+#pragma once
+#include <hiredis.h>
+#include <async.h>
+#include "event2/event.h"
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+
+#include "slothash.h"
+#include "asynccluster.h"
+
+namespace RedisClusterAPI
+{
+
+enum ShardPolicy {
+    SHARD_BY_SLOT = 0,     // keeps the order of the commands of a slot
+    SHARD_BY_THREAD        // keeps the order of the commands of a caller thread
+};
+
+// one event loop, its thread and its own connections to every master
+struct AsyncShard
+{
+    int index;
+    struct event_base *base;
+    AsyncCluster *cluster;
+    std::thread *thread;
+    int stopFd;
+    struct event *stop;
+};
+
+// N AsyncCluster event loops on N threads, each with its own connections.
+//   Any thread may submit: the command is formatted by the caller, pushed on
+// the SubmitQueue of the loop its key (or its thread) maps to and run there,
+// so replies are parsed and callbacks run on that loop's thread. The 
+// callback of a loop is set on GetShard(i) before Start() and receives that
+// AsyncCluster as 'self'. A command that cannot be dispatched completes with
+// a NULL reply.
+class ShardedAsyncCluster
+{
+public:
+    ShardedAsyncCluster(const char *ip,
+                        int port,
+                        int connect_timeout,
+                        int command_timeout,
+                        int loops,
+                        ShardPolicy policy = SHARD_BY_SLOT,
+                        bool pin = false,
+                        bool debug = false);
+    ~ShardedAsyncCluster();
+    ShardedAsyncCluster(const ShardedAsyncCluster &) = delete;
+    ShardedAsyncCluster& operator=(const ShardedAsyncCluster &) = delete;
+
+    bool Start();
+    void Stop();
+    bool Set(std::string_view key, std::string_view val, void *privdata = NULL);
+    bool Get(std::string_view key, void *privdata = NULL);
+    bool CommandArgv(std::string_view key, void *privdata,
+                     int argc, const std::string_view *argv);
+public:
+    int GetLoopCount() { return (int)_shards->size(); }
+    AsyncCluster *GetShard(int index) { return (*_shards)[index]->cluster; }
+    int GetShardIndex(std::string_view key);
+    SubmitQueue *GetSubmitQueue(int index) { return GetShard(index)->GetSubmitQueue(); }
+    bool is_running() { return _running; }
+private:
+    static void RunShard(AsyncShard *shard, bool pin);
+    static void OnStop(evutil_socket_t fd, short what, void *arg);
+private:
+    std::vector<AsyncShard *> *_shards;
+    ShardPolicy _policy;
+    bool _pin;
+    bool _running;
+};
+
+} // RedisClusterAPI
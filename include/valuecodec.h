@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define CODEC_DEFAULT_THRESHOLD 1024
+#define CODEC_HEADER_SIZE 7
+#define CODEC_MAX_VALUE_SIZE (512 * 1024 * 1024)
+
+namespace RedisClusterAPI
+{
+
+enum CodecType {
+    CODEC_RAW = 0,
+    CODEC_LZ4 = 1
+};
+
+class ValueCodec
+{
+public:
+    virtual ~ValueCodec() {}
+    virtual uint8_t GetId() = 0;
+    // worst case size of Compress() for 'len' bytes
+    virtual size_t Bound(size_t len) = 0;
+    // returns the compressed size, 0 if it does not fit in 'cap' bytes
+    virtual size_t Compress(const char *src, size_t len, char *dst, size_t cap) = 0;
+    // 'rawlen' is exact, false on corrupted input
+    virtual bool Decompress(const char *src, size_t len, char *dst, size_t rawlen) = 0;
+    // largest raw size 'len' compressed bytes may decode to
+    virtual size_t MaxRaw(size_t len) = 0;
+};
+
+// LZ4 block format, greedy single-pass matching with a 4K entries hash table.
+//   Blocks are readable by LZ4_decompress_safe() and the other way around, so
+// the library can replace this codec without rewriting stored values.
+class Lz4Codec : public ValueCodec
+{
+public:
+    virtual uint8_t GetId() { return CODEC_LZ4; }
+    virtual size_t Bound(size_t len) { return len + len / 255 + 16; }
+    virtual size_t Compress(const char *src, size_t len, char *dst, size_t cap);
+    virtual bool Decompress(const char *src, size_t len, char *dst, size_t rawlen);
+    // a match byte expands to at most 255 bytes
+    virtual size_t MaxRaw(size_t len) { return len * 255 + 16; }
+public:
+    static Lz4Codec *GetInstance();
+};
+
+// Transparent value compression of the Set/Get path, per key prefix.
+//   Values at least 'threshold' bytes long under a prefix with a codec are 
+// stored as a 7 bytes header (0xC7 'Z', codec id, raw length as 32-bit little
+// endian) followed by the compressed bytes, only if that is smaller. A value 
+// stored as is but starting with the magic gets a CODEC_RAW header, so any 
+// value read back through Decode() is exactly the one given to Encode(). The
+// longest matching prefix wins, a NULL codec disables compression under it.
+//   Views returned by Encode()/Decode() are valid until the next call. A 
+// header claiming more than the max value size, or more than the codec can
+// produce from the compressed bytes, fails Decode() without allocating.
+class ValueCompressor
+{
+public:
+    struct Rule
+    {
+        std::string prefix;
+        ValueCodec *codec;
+        size_t threshold;
+    };
+public:
+    ValueCompressor();
+    ~ValueCompressor();
+    ValueCompressor(const ValueCompressor &) = delete;
+    ValueCompressor& operator=(const ValueCompressor &) = delete;
+
+    void AddRule(std::string_view prefix, 
+                 ValueCodec *codec, 
+                 size_t threshold = CODEC_DEFAULT_THRESHOLD);
+    bool Encode(std::string_view key, std::string_view value, std::string_view &output);
+    bool Decode(std::string_view value, std::string_view &output);
+public:
+    uint64_t GetRawBytes() { return _rawBytes; }
+    uint64_t GetWireBytes() { return _wireBytes; }
+    uint64_t GetCompressedCount() { return _compressed; }
+    void ResetStats();
+    void SetMaxValueSize(size_t size) { _maxValueSize = size; }
+    size_t GetMaxValueSize() { return _maxValueSize; }
+private:
+    const Rule *FindRule(std::string_view key);
+    ValueCodec *FindCodec(uint8_t id);
+    static bool Reserve(char **buf, size_t *cap, size_t len);
+private:
+    std::vector<Rule> *_rules;
+    char *_encodeBuf;
+    size_t _encodeCap;
+    char *_decodeBuf;
+    size_t _decodeCap;
+    size_t _maxValueSize;
+    uint64_t _rawBytes;
+    uint64_t _wireBytes;
+    uint64_t _compressed;
+};
+
+} // RedisClusterAPI
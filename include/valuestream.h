@@ -0,0 +1,114 @@
+#pragma once
+#include <hiredis.h>
+
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <map>
+#include <set>
+#include <vector>
+#include <stdint.h>
+
+#include "asynccluster.h"
+
+#define STREAM_CHUNK_SIZE (256 * 1024)
+#define STREAM_WINDOW 2
+
+namespace RedisClusterAPI
+{
+
+class StreamSource
+{
+public:
+    virtual ~StreamSource() {}
+    // fills at most 'size' bytes of 'buf', returns 0 at the end of the value
+    virtual size_t Read(char *buf, size_t size) = 0;
+    // 'status' is REDIS_OK once the whole value has been stored
+    virtual void OnDone(int status, uint64_t bytes) = 0;
+};
+
+class StreamSink
+{
+public:
+    virtual ~StreamSink() {}
+    // chunks arrive in order, 'chunk' is only valid during the call
+    virtual void Write(std::string_view chunk) = 0;
+    // a missing key reads as an empty value
+    virtual void OnDone(int status, uint64_t bytes) = 0;
+};
+
+// Chunked transfer of large string values on top of AsyncCluster.
+//   Write() stores the value with one SET of the first chunk followed by 
+// SETRANGE of the others, Read() fetches it with GETRANGE. At most 'window'
+// chunks of a stream are on the wire at once, so memory is bounded by 
+// window * chunkSize per stream and the other commands to the node are 
+// interleaved between chunks instead of waiting behind one huge transfer.
+//   A stream that finds its node full with no chunk on the wire is parked 
+// until OnReady(), which the cluster callback forwards, or the reply of 
+// another stream. A transfer is not atomic: readers may see a partially 
+// written value. The streamer must outlive the streams it started.
+class ValueStreamer : public AsyncClusterCallback
+{
+public:
+    ValueStreamer(AsyncCluster *asyncCluster, 
+                  uint32_t chunkSize = STREAM_CHUNK_SIZE, 
+                  uint32_t window = STREAM_WINDOW);
+    ~ValueStreamer();
+    ValueStreamer(const ValueStreamer &) = delete;
+    ValueStreamer& operator=(const ValueStreamer &) = delete;
+
+    bool Write(std::string_view key, StreamSource *source);
+    bool Read(std::string_view key, StreamSink *sink);
+public:
+    AsyncCluster *GetAsyncCluster() { return _asyncCluster; }
+    uint32_t GetActiveCount() { return _streams->size(); }
+    uint64_t GetChunkCount() { return _chunks; }
+    uint64_t GetByteCount() { return _bytes; }
+    uint32_t GetParkedCount() { return _parked; }
+public:
+    virtual void OnConnect(const redisAsyncContext *, int) {}
+    virtual void OnDisconnect(const redisAsyncContext *, int) {}
+    virtual void OnCommand(redisReply *reply, void *self, void *privdata);
+    virtual void OnReady(const char *);
+private:
+    struct Stream
+    {
+        std::string key;
+        StreamSource *source;
+        StreamSink *sink;
+        uint64_t offset;       // next byte to send or to request
+        uint64_t done;         // bytes stored or delivered in order
+        uint32_t inflight;
+        bool started;          // the first SET has been stored
+        bool eof;
+        bool failed;
+        bool parked;           // waits for room on the node
+        std::vector<char *> buffers;              // write buffers off the wire
+        std::map<uint64_t, std::string> pending;  // read chunks out of order
+    };
+    struct Chunk
+    {
+        Stream *stream;
+        uint64_t offset;
+        char *buf;
+        uint32_t len;
+    };
+private:
+    void Pump(Stream *stream);
+    void ResumeParked();
+    bool SendWriteChunk(Stream *stream);
+    bool SendReadChunk(Stream *stream);
+    void OnWriteReply(Chunk *chunk, redisReply *reply);
+    void OnReadReply(Chunk *chunk, redisReply *reply);
+    void Finish(Stream *stream);
+private:
+    AsyncCluster *_asyncCluster;
+    std::set<Stream *> *_streams;
+    uint32_t _chunkSize;
+    uint32_t _window;
+    uint64_t _chunks;
+    uint64_t _bytes;
+    uint32_t _parked;
+};
+
+} // RedisClusterAPI
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <type_traits>
+
+namespace RedisClusterAPI
+{
+
+// Serialization of the typed Set<T>/Get<T> values.
+//   Size() is the exact encoded length, Write() encodes the value straight 
+// into the command buffer and returns Size() bytes written, Read() decodes
+// the bytes of the reply, which are only valid during the call. Integers and
+// floats use the decimal text Redis understands (INCRBY, INCRBYFLOAT), other 
+// trivially copyable types are stored as their raw bytes. User types plug in
+// by specializing ValueTraits:
+//
+//   template<> struct ValueTraits<Point> {
+//       static size_t Size(const Point &p);
+//       static size_t Write(char *buf, const Point &p);
+//       static bool Read(std::string_view bytes, Point &p);
+//   };
+template<typename T, typename ENABLE = void>
+struct ValueTraits
+{
+    static_assert(sizeof(T) == 0, "no ValueTraits specialization for this type");
+};
+
+template<typename T>
+struct ValueTraits<T, typename std::enable_if<std::is_integral<T>::value && 
+                                              !std::is_same<T, bool>::value>::type>
+{
+    static const size_t MAXLEN = 24;
+
+    static size_t Size(T value)
+    {
+        char buf[MAXLEN];
+        return std::to_chars(buf, buf + MAXLEN, value).ptr - buf;
+    }
+
+    static size_t Write(char *buf, T value)
+    {
+        return std::to_chars(buf, buf + MAXLEN, value).ptr - buf;
+    }
+
+    static bool Read(std::string_view bytes, T &value)
+    {
+        T res;
+        const char *end = bytes.data() + bytes.size();
+        std::from_chars_result parsed = std::from_chars(bytes.data(), end, res);
+        if (parsed.ec != std::errc() || parsed.ptr != end) {
+            return false;
+        }
+        value = res;
+        return true;
+    }
+};
+
+template<>
+struct ValueTraits<bool>
+{
+    static size_t Size(bool) { return 1; }
+
+    static size_t Write(char *buf, bool value)
+    {
+        *buf = value ? '1' : '0';
+        return 1;
+    }
+
+    static bool Read(std::string_view bytes, bool &value)
+    {
+        if (bytes.size() != 1 || (bytes[0] != '0' && bytes[0] != '1')) {
+            return false;
+        }
+        value = bytes[0] == '1';
+        return true;
+    }
+};
+
+template<typename T>
+struct ValueTraits<T, typename std::enable_if<std::is_enum<T>::value>::type>
+{
+    typedef typename std::underlying_type<T>::type Integer;
+
+    static size_t Size(T value) 
+    { 
+        return ValueTraits<Integer>::Size((Integer)value); 
+    }
+
+    static size_t Write(char *buf, T value) 
+    { 
+        return ValueTraits<Integer>::Write(buf, (Integer)value); 
+    }
+
+    static bool Read(std::string_view bytes, T &value)
+    {
+        Integer integer;
+        if (ValueTraits<Integer>::Read(bytes, integer) == false) {
+            return false;
+        }
+        value = (T)integer;
+        return true;
+    }
+};
+
+// enough digits to read back the same value
+template<typename T>
+struct ValueTraits<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static const size_t MAXLEN = 64;
+
+    static size_t Size(T value)
+    {
+        char buf[MAXLEN];
+        return Format(buf, value);
+    }
+
+    static size_t Write(char *buf, T value)
+    {
+        char tmp[MAXLEN];
+        size_t len = Format(tmp, value);
+        memcpy(buf, tmp, len);
+        return len;
+    }
+
+    static bool Read(std::string_view bytes, T &value)
+    {
+        char buf[MAXLEN];
+        char *end;
+        if (bytes.empty() || bytes.size() >= MAXLEN) {
+            return false;
+        }
+        memcpy(buf, bytes.data(), bytes.size());
+        buf[bytes.size()] = '\0';
+        long double res = strtold(buf, &end);
+        if (end != buf + bytes.size()) {
+            return false;
+        }
+        value = (T)res;
+        return true;
+    }
+private:
+    static size_t Format(char *buf, T value)
+    {
+        int digits = std::is_same<T, float>::value ? 9 : 
+                     std::is_same<T, double>::value ? 17 : 21;
+        return snprintf(buf, MAXLEN, "%.*Lg", digits, (long double)value);
+    }
+};
+
+template<typename T>
+struct ValueTraits<T, typename std::enable_if<std::is_trivially_copyable<T>::value && 
+                                              std::is_class<T>::value>::type>
+{
+    static size_t Size(const T &value) { return sizeof(T); }
+
+    static size_t Write(char *buf, const T &value)
+    {
+        memcpy(buf, &value, sizeof(T));
+        return sizeof(T);
+    }
+
+    static bool Read(std::string_view bytes, T &value)
+    {
+        if (bytes.size() != sizeof(T)) {
+            return false;
+        }
+        memcpy(&value, bytes.data(), sizeof(T));
+        return true;
+    }
+};
+
+template<>
+struct ValueTraits<std::string>
+{
+    static size_t Size(const std::string &value) { return value.size(); }
+
+    static size_t Write(char *buf, const std::string &value)
+    {
+        memcpy(buf, value.data(), value.size());
+        return value.size();
+    }
+
+    static bool Read(std::string_view bytes, std::string &value)
+    {
+        value.assign(bytes.data(), bytes.size());
+        return true;
+    }
+};
+
+// write only, a view cannot outlive the reply
+template<>
+struct ValueTraits<std::string_view>
+{
+    static size_t Size(std::string_view value) { return value.size(); }
+
+    static size_t Write(char *buf, std::string_view value)
+    {
+        memcpy(buf, value.data(), value.size());
+        return value.size();
+    }
+};
+
+// typed accessors leave strings to the string_view overloads
+template<typename T>
+using EnableIfTyped = typename std::enable_if<
+        !std::is_convertible<const T &, std::string_view>::value>::type;
+
+} // RedisClusterAPI
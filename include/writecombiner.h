@@ -0,0 +1,83 @@
+#pragma once
+#include <hiredis.h>
+#include <event2/event.h>
+
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <map>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "asynccluster.h"
+
+namespace RedisClusterAPI
+{
+
+// Opt-in write-combining buffer in front of AsyncCluster.
+//   INCRBY/HINCRBY deltas to the same key (field) are summed and repeated SETs
+// to the same key collapse into the last value. The buffer is flushed every 
+// 'flush_interval' ms, once 'flush_size' distinct entries are pending, on 
+// Flush() and on destruction. Every flushed command reports to the callback
+// of the AsyncCluster with the 'privdata' given here. An entry whose command
+// cannot be issued (COMMAND_QUEUEFULL, no node) stays pending for the next
+// flush, what is still pending at destruction is dropped. After such a 
+// failure the 'flush_size' trigger waits for the timer, Flush() or OnReady(),
+// which the cluster callback forwards.
+class WriteCombiner
+{
+public:
+    struct KeyEntry {
+        KeyEntry() : hasValue(false), delta(0), hasDelta(false) {}
+        bool hasValue;
+        std::string value;   // last SET value
+        long long delta;     // sum of INCRBY applied after the SET (if any)
+        bool hasDelta;
+    };
+    typedef std::pair<std::string, std::string>              HashField;
+    typedef std::unordered_map<std::string, KeyEntry>       KeyMap;
+    typedef std::map<HashField, long long>                   HashMap;
+public:
+    WriteCombiner(AsyncCluster *asyncCluster, 
+                  int flush_interval, 
+                  uint32_t flush_size, 
+                  void *privdata = NULL);
+    ~WriteCombiner();
+    WriteCombiner(const WriteCombiner &) = delete;
+    WriteCombiner& operator=(const WriteCombiner &) = delete;
+
+    bool Set(std::string_view key, std::string_view val);
+    bool IncrBy(std::string_view key, long long delta);
+    bool HIncrBy(std::string_view key, std::string_view field, long long delta);
+    int Flush();
+    void Shutdown();
+    // a node has room again, retries the flush held back by a failure
+    void OnReady();
+public:
+    uint64_t GetReceivedCount() { return _received; }
+    uint64_t GetFlushedCount() { return _flushed; }
+    uint64_t GetSavedCount() { return _saved; }
+    uint32_t GetPendingCount() { return _keyMap->size() + _hashMap->size(); }
+private:
+    bool Issue(std::string_view key, int argc, const std::string_view *argv);
+    void CheckFlushSize();
+    static void OnFlushTimer(evutil_socket_t fd, short what, void *arg);
+private:
+    AsyncCluster *_asyncCluster;
+    KeyMap *_keyMap;
+    HashMap *_hashMap;
+    std::string _lookup;    // reused for the lookups, no allocation on a hit
+    HashField _lookupField;
+    struct event *_timer;
+    void *_privdata;
+    uint32_t _flush_size;
+    uint64_t _received;
+    uint64_t _flushed;
+    uint64_t _saved;
+    uint64_t _pendingOps;
+    uint64_t _issued;       // commands flushed for the '_pendingOps'
+    bool _backoff;          // the last size-triggered flush failed
+    bool _shutdown;
+};
+
+} // RedisClusterAPI
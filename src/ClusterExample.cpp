@@ -8,6 +8,8 @@ static timeval _end;
 
 static long int _TESTCASES;
 
+static ValueStreamer *_streamer;
+
 ClusterExample::ClusterExample(long int testcases)
     : _ev_base(NULL),
       _asyncCluster(NULL),
@@ -67,6 +69,21 @@ void ClusterExample::cluster_test()
     cluster_get_test(_cluster, "Radeon_RX_6800_XT", buff);
     cluster_get_test(_cluster, "Radeon_RX_6900_XT", buff);
 
+    // copied once, from the read buffer of the connection
+    char value[64];
+    size_t len;
+    if (_cluster->Get(std::string_view("GeForce_RTX_3090"), value, sizeof(value), &len)) {
+        std::cout << "[GET into buffer]: GeForce_RTX_3090 => " 
+                  << std::string_view(value, len) << std::endl;
+    }
+
+    // typed values are serialized straight into the command
+    std::string_view stockKey("GeForce_RTX_3090_stock");
+    int stock = 0;
+    if (_cluster->Set(stockKey, 42) && _cluster->Get(stockKey, stock)) {
+        std::cout << "[typed GET]: " << stockKey << " => " << stock << std::endl;
+    }
+
     if (_cluster->DisConnect()) {
         std::cout << "Disconnected." << std::endl;
     }
@@ -112,6 +129,48 @@ void ClusterExample::cluster_get_test(Cluster *cluster,
     count++;
 }
 
+static long int elapsed_msec(const timeval &start, const timeval &end)
+{
+    return (end.tv_sec - start.tv_sec) * 1000 + (end.tv_usec - start.tv_usec) / 1000;
+}
+
+//   The node connections carry the timeouts of the cluster, in seconds: a 
+// connect to an unreachable seed gives up after the connect timeout, and a 
+// BLPOP on an empty list returns after the command timeout instead of 
+// blocking.
+void ClusterExample::connection_timeout_test()
+{
+    timeval start, end;
+    Cluster *unreachable = new Cluster(UNREACHABLE_IP, PORT3, SHORT_TIMEOUT, TIMEOUT, 
+                                       DEBUG_MODE);
+    gettimeofday(&start, NULL);
+    bool connected = unreachable->Connect();
+    gettimeofday(&end, NULL);
+    std::cout << "[timeouts | connect to " << UNREACHABLE_IP << " | "
+              << (connected ? "connected" : "failed") << " after " 
+              << elapsed_msec(start, end) << "ms"
+              << " | connect timeout: " << SHORT_TIMEOUT << "s]\n";
+    delete unreachable;
+
+    Cluster *cluster = new Cluster(IP, PORT3, TIMEOUT, SHORT_TIMEOUT, DEBUG_MODE);
+    if (cluster->Connect() == false) {
+        std::cout << "[timeouts | connection failed]" << std::endl;
+        delete cluster;
+        return;
+    }
+    std::string_view argv[3] = { "BLPOP", "timeout:empty", "0" };
+    gettimeofday(&start, NULL);
+    redisReply *reply = cluster->CommandArgv(argv[1], 3, argv);
+    gettimeofday(&end, NULL);
+    std::cout << "[timeouts | BLPOP | " << (reply ? "replied" : "timed out") << " after "
+              << elapsed_msec(start, end) << "ms"
+              << " | command timeout: " << SHORT_TIMEOUT << "s"
+              << " | next SET: " << (cluster->Set("timeout:next", "value") ? "OK" : "FAILED") 
+              << "]\n";
+    freeReplyObject(reply);
+    delete cluster;
+}
+
 //////////////////////ASYNC REDIS CLUSTER API TESTS/////////////////////////////
 
 void ClusterExample::async_cluster_test()
@@ -130,8 +189,558 @@ void ClusterExample::async_cluster_test()
     }
 }
 
+// no callback class: lambdas complete the commands on the loop thread, and 
+// another thread waits for a reply through a future
+void ClusterExample::completion_handler_test()
+{
+    struct event_base *base = event_base_new();
+    AsyncCluster *asyncCluster = new AsyncCluster(IP, PORT3, TIMEOUT, TIMEOUT, base, 
+                                                  NULL, DEBUG_MODE);
+    asyncCluster->Connect();
+    asyncCluster->EnableSubmitQueue();
+
+    asyncCluster->Set("handler", "value", [](redisReply *reply) {
+        std::cout << "[SET | handler | " << (reply ? reply->str : "failed") << "]\n";
+    });
+    asyncCluster->Get("handler", [](redisReply *reply) {
+        std::cout << "[GET | handler | " << (reply && reply->str ? reply->str : "failed") 
+                  << "]\n";
+    });
+    std::thread loop([base]() { event_base_loop(base, EVLOOP_NO_EXIT_ON_EMPTY); });
+
+    std::string_view argv[2] = { "GET", "handler" };
+    std::future<CommandResult> future = asyncCluster->SubmitFuture("handler", 2, argv);
+    try {
+        CommandResult result = future.get();
+        std::cout << "[GET | future | " 
+                  << (result.is_ok() ? result.GetString() : "failed") << "]\n";
+    } catch (const std::future_error &e) {
+        std::cout << "[GET | future | " << e.what() << "]\n";
+    }
+
+    // stopped from its own thread
+    std::string_view ping[1] = { "PING" };
+    while (asyncCluster->Submit("handler", 1, ping, [base](redisReply *) {
+        event_base_loopbreak(base);
+    }) == false) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    loop.join();
+
+    delete asyncCluster;
+    event_base_free(base);
+}
+
+#ifdef REDIS_CLUSTER_ASIO_AWAIT
+static net::awaitable<void> asio_counter(AsioCluster &asioCluster, std::string key, int rounds)
+{
+    for (int i = 0; i < rounds; i++) {
+        CommandResult value = co_await asioCluster.AsyncGet(key, net::use_awaitable);
+        if (value.is_ok() == false) {
+            std::cout << "[GET | awaitable | failed]\n";
+            co_return;
+        }
+        long int counter = value.is_nil() ? 0 : atol(std::string(value.GetString()).c_str());
+        co_await asioCluster.AsyncSet(key, std::to_string(counter + 1), net::use_awaitable);
+    }
+    std::cout << "[GET/SET | awaitable | " << rounds << " rounds]\n";
+}
+#endif
+
+// cluster I/O on an io_context run by ASIO_THREADS threads, completed through
+// a callback, a future and, when the compiler has coroutines, an awaitable
+void ClusterExample::asio_cluster_test()
+{
+#ifdef REDIS_CLUSTER_ASIO
+    net::io_context io;
+    net::executor_work_guard<net::io_context::executor_type> work = net::make_work_guard(io);
+    AsioCluster *asioCluster = new AsioCluster(io, IP, PORT3, TIMEOUT, TIMEOUT, 
+                                               NULL, DEBUG_MODE);
+    if (asioCluster->Connect() == false) {
+        std::cout << "[asio | connect failed]" << std::endl;
+        delete asioCluster;
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < ASIO_THREADS; i++) {
+        threads.emplace_back([&io]() { io.run(); });
+    }
+
+    asioCluster->AsyncSet("asio", "value", [](CommandResult result) {
+        std::cout << "[SET | callback | " 
+                  << (result.is_ok() ? result.GetString() : "failed") << "]\n";
+    });
+    std::future<CommandResult> future = asioCluster->AsyncGet("asio", net::use_future);
+    CommandResult result = future.get();
+    std::cout << "[GET | future | " << (result.is_ok() ? result.GetString() : "failed") 
+              << "]\n";
+#ifdef REDIS_CLUSTER_ASIO_AWAIT
+    net::co_spawn(io, asio_counter(*asioCluster, "asio:counter", COROUTINE_ROUNDS), 
+                  net::use_future).get();
+#endif
+
+    // the cluster is deleted on its strand
+    std::promise<void> deleted;
+    net::post(asioCluster->get_executor(), [asioCluster, &deleted]() {
+        delete asioCluster;
+        deleted.set_value();
+    });
+    deleted.get_future().wait();
+    work.reset();
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+#else
+    std::cout << "[asio | needs Boost.Asio or standalone Asio]" << std::endl;
+#endif
+}
+
+// completions of the feature runs, the loop stops once '_countTarget' 
+// commands are done
+static long int _countDone;
+static long int _countFailed;
+static long int _countTarget;
+
+static void count_reset(long int target)
+{
+    _countDone = 0;
+    _countFailed = 0;
+    _countTarget = target;
+}
+
+// a command that is not issued never reaches the callback
+static void count_issued(bool issued)
+{
+    if (issued == false) {
+        _countFailed++;
+        _countDone++;
+    }
+}
+
+// a string reply must match the std::string the privdata points to, if any
+static void count_on_command(redisReply *reply, void *self, void *privdata)
+{
+    const std::string *expected = (const std::string *)privdata;
+    if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
+        _countFailed++;
+    } else if (expected && (reply->type != REDIS_REPLY_STRING || 
+               std::string(reply->str, reply->len) != *expected)) {
+        _countFailed++;
+    }
+    if (++_countDone == _countTarget) {
+        event_base_loopbreak(((AsyncCluster *)self)->GetEvBase());
+    }
+}
+
+// identical GETs issued back to back: with single flight on, the first one 
+// goes on the wire and the others follow it and get the same reply
+static void single_flight_run(bool enable)
+{
+    struct event_base *base = event_base_new();
+    AsyncCluster *asyncCluster = new AsyncCluster(IP, PORT3, TIMEOUT, TIMEOUT, base, 
+                                                  new TestRunAsyncClusterCallback(count_on_command));
+    asyncCluster->SetSingleFlight(enable);
+    asyncCluster->Connect();
+
+    std::string value("single flight value");
+    count_reset(SINGLE_FLIGHT_CALLERS + 1);
+    count_issued(asyncCluster->Set("single_flight", value.c_str()));
+    for (long int i = 0; i < SINGLE_FLIGHT_CALLERS; i++) {
+        count_issued(asyncCluster->Get("single_flight", &value));
+    }
+    if (_countDone < _countTarget) {
+        event_base_dispatch(base);
+    }
+
+    uint64_t followers = asyncCluster->GetSingleFlightHits();
+    std::cout << "[single flight | " << (enable ? "on " : "off")
+              << " | GET: " << SINGLE_FLIGHT_CALLERS
+              << " | sent: " << SINGLE_FLIGHT_CALLERS - followers
+              << " | followers: " << followers
+              << " | completed: " << _countDone
+              << " | failed: " << _countFailed << "]\n";
+
+    delete asyncCluster;
+    event_base_free(base);
+}
+
+void ClusterExample::single_flight_test()
+{
+    single_flight_run(false);
+    single_flight_run(true);
+}
+
+// Flush() keeps what it cannot issue: before Connect() no node is known and
+// every entry stays pending. Once connected, the SET of the counter leaves 
+// before the summed INCRBY, so the counter reads back as the increment count.
+void ClusterExample::write_combiner_test()
+{
+    struct event_base *base = event_base_new();
+    AsyncCluster *asyncCluster = new AsyncCluster(IP, PORT3, TIMEOUT, TIMEOUT, base, 
+                                                  new TestRunAsyncClusterCallback(count_on_command));
+    WriteCombiner *combiner = new WriteCombiner(asyncCluster, 0, 0);
+
+    combiner->Set("combiner:counter", "0");
+    for (long int i = 0; i < COMBINER_INCREMENTS; i++) {
+        combiner->IncrBy("combiner:counter", 1);
+        combiner->HIncrBy("combiner:hash", "field", 1);
+    }
+    int failed = combiner->Flush();
+    std::cout << "[write combiner | before Connect() | failed: " << failed
+              << " | pending: " << combiner->GetPendingCount() << "]\n";
+
+    asyncCluster->Connect();
+    failed = combiner->Flush();
+    count_reset(combiner->GetFlushedCount());
+    if (_countDone < _countTarget) {
+        event_base_dispatch(base);
+    }
+    long int flushFailed = _countFailed;
+
+    std::string counter = std::to_string(COMBINER_INCREMENTS);
+    count_reset(1);
+    count_issued(asyncCluster->Get("combiner:counter", &counter));
+    if (_countDone < _countTarget) {
+        event_base_dispatch(base);
+    }
+    std::cout << "[write combiner | received: " << combiner->GetReceivedCount()
+              << " | flushed: " << combiner->GetFlushedCount()
+              << " | saved: " << combiner->GetSavedCount()
+              << " | pending: " << combiner->GetPendingCount()
+              << " | failed: " << failed + flushFailed
+              << " | counter: " << (_countFailed ? "MISMATCH" : "OK") << "]\n";
+
+    delete combiner;
+    delete asyncCluster;
+    event_base_free(base);
+}
+
+static NoReplyWriter *_noReplyWriter;
+static uint64_t _noReplyConfirmed;
+
+// reports each confirmed checkpoint, the loop stops once every write is 
+// confirmed or lost
+static void noreply_check(evutil_socket_t, short, void *arg)
+{
+    if (_noReplyWriter->GetConfirmedCount() != _noReplyConfirmed) {
+        _noReplyConfirmed = _noReplyWriter->GetConfirmedCount();
+        std::cout << "[NoReplyWriter | checkpoint | confirmed: " << _noReplyConfirmed 
+                  << "/" << _noReplyWriter->GetSentCount() << "]\n";
+    }
+    if (_noReplyConfirmed + _noReplyWriter->GetLostCount() >= _noReplyWriter->GetSentCount()) {
+        event_base_loopbreak((struct event_base *)arg);
+    }
+}
+
+// the SETs get no reply, only the PONG of every checkpoint tells how many of
+// them the server has processed
+void ClusterExample::noreply_writer_test()
+{
+    struct event_base *base = event_base_new();
+    AsyncCluster *asyncCluster = new AsyncCluster(IP, PORT3, TIMEOUT, TIMEOUT, base, 
+                                                  new TestRunAsyncClusterCallback(count_on_command));
+    asyncCluster->Connect();
+    _noReplyWriter = new NoReplyWriter(asyncCluster, 0, NOREPLY_CHECKPOINT_COUNT);
+    _noReplyConfirmed = 0;
+
+    char key[32];
+    long int failed = 0;
+    for (long int i = 0; i < NOREPLY_WRITES; i++) {
+        sprintf(key, "noreply:%ld", i);
+        if (_noReplyWriter->Set(key, key) == false) {
+            failed++;
+        }
+    }
+    // fences what is left after the last automatic checkpoint
+    failed += _noReplyWriter->Checkpoint();
+
+    struct event *check = event_new(base, -1, EV_PERSIST, noreply_check, base);
+    timeval tv = { 0, 10 * 1000 };
+    event_add(check, &tv);
+    timeval deadline = { NOREPLY_WAIT, 0 };
+    event_base_loopexit(base, &deadline);
+    event_base_dispatch(base);
+    event_free(check);
+
+    // the last write is readable once its checkpoint is confirmed
+    std::string last(key);
+    count_reset(1);
+    count_issued(asyncCluster->Get(key, &last));
+    if (_countDone < _countTarget) {
+        event_base_dispatch(base);
+    }
+    std::cout << "[NoReplyWriter | SET: " << NOREPLY_WRITES
+              << " | sent: " << _noReplyWriter->GetSentCount()
+              << " | confirmed: " << _noReplyWriter->GetConfirmedCount()
+              << " | lost: " << _noReplyWriter->GetLostCount()
+              << " | failed: " << failed
+              << " | last write: " << (_countFailed ? "MISSING" : "OK") << "]\n";
+
+    delete _noReplyWriter;
+    _noReplyWriter = NULL;
+    delete asyncCluster;
+    event_base_free(base);
+}
+
+//   A corked batch leaves in one write per node on Uncork(). A command whose
+// node connection went away while corked fails in Uncork() and still 
+// completes, with a NULL reply.
+void ClusterExample::cork_test()
+{
+    struct event_base *base = event_base_new();
+    AsyncCluster *asyncCluster = new AsyncCluster(IP, PORT3, TIMEOUT, TIMEOUT, base, 
+                                                  new TestRunAsyncClusterCallback(count_on_command));
+    asyncCluster->Connect();
+
+    char key[32];
+    count_reset(CORK_COMMANDS);
+    {
+        AsyncClusterBatch batch(asyncCluster);
+        for (long int i = 0; i < CORK_COMMANDS; i++) {
+            sprintf(key, "cork:%ld", i);
+            count_issued(asyncCluster->Set(key, key));
+        }
+    }
+    if (_countDone < _countTarget) {
+        event_base_dispatch(base);
+    }
+    std::cout << "[cork | batch | SET: " << CORK_COMMANDS 
+              << " | failed: " << _countFailed << "]\n";
+
+    count_reset(CORK_COMMANDS);
+    asyncCluster->Cork();
+    for (long int i = 0; i < CORK_COMMANDS; i++) {
+        sprintf(key, "cork:%ld", i);
+        count_issued(asyncCluster->Set(key, key));
+    }
+    // nothing is pending on it, the connection is closed right away
+    AsyncCluster::ClusterNode *node = 
+            asyncCluster->GetPool()->GetNodeBySlot(SlotHash::slotByKey("cork:0", 6));
+    if (node && node->second.context) {
+        redisAsyncDisconnect(node->second.context);
+    }
+    int failed = asyncCluster->Uncork();
+    if (_countDone < _countTarget) {
+        event_base_dispatch(base);
+    }
+    std::cout << "[cork | node closed while corked | SET: " << CORK_COMMANDS
+              << " | failed in Uncork(): " << failed
+              << " | failed: " << _countFailed
+              << " | completed: " << _countDone << "]\n";
+
+    delete asyncCluster;
+    event_base_free(base);
+}
+
+static long int _flowSent;
+static uint32_t _flowPeak;
+
+// SETs until a node rejects one with COMMAND_QUEUEFULL, refilled by the 
+// next completion
+static void flow_send(AsyncCluster *asyncCluster)
+{
+    char key[32];
+    while (_flowSent < _TESTCASES) {
+        sprintf(key, "flow:%ld", _flowSent);
+        if (asyncCluster->Set(key, key) == false) {
+            if (asyncCluster->GetLastCommandResult() == COMMAND_QUEUEFULL) {
+                break;
+            }
+            count_issued(false);
+        }
+        _flowSent++;
+    }
+}
+
+static void flow_on_command(redisReply *reply, void *self, void *privdata)
+{
+    AsyncCluster *asyncCluster = (AsyncCluster *)self;
+    AsyncCluster::FlowControlMap *flowControlMap = asyncCluster->GetFlowControlMap();
+    AsyncCluster::FlowControlMap::iterator it;
+    for (it = flowControlMap->begin(); it != flowControlMap->end(); it++) {
+        if (it->second.limit > _flowPeak) {
+            _flowPeak = it->second.limit;
+        }
+    }
+    count_on_command(reply, self, privdata);
+    if (_countDone < _countTarget) {
+        flow_send(asyncCluster);
+    }
+}
+
+//   The adaptive limit starts at FLOW_MIN_INFLIGHT and grows by one per window
+// of completions under the latency target. With a target no completion can
+// meet, every window halves it back to the minimum.
+static void flow_control_run(int64_t latencyTarget)
+{
+    struct event_base *base = event_base_new();
+    AsyncCluster *asyncCluster = new AsyncCluster(IP, PORT3, TIMEOUT, TIMEOUT, base, 
+                                                  new TestRunAsyncClusterCallback(flow_on_command));
+    FlowControlOptions opts;
+    opts.maxInflight = FLOW_MAX_INFLIGHT;
+    opts.adaptive = true;
+    opts.minInflight = FLOW_MIN_INFLIGHT;
+    opts.latencyTarget = latencyTarget;
+    asyncCluster->SetFlowControl(opts);
+    asyncCluster->Connect();
+
+    _flowSent = 0;
+    _flowPeak = 0;
+    count_reset(_TESTCASES);
+    flow_send(asyncCluster);
+    if (_countDone < _countTarget) {
+        event_base_dispatch(base);
+    }
+
+    std::cout << "[AIMD | latency target: " << latencyTarget << "us"
+              << " | SET: " << _TESTCASES
+              << " | failed: " << _countFailed
+              << " | peak limit: " << _flowPeak << "/" << FLOW_MAX_INFLIGHT << "]";
+    asyncCluster->PrintFlowControl();
+
+    delete asyncCluster;
+    event_base_free(base);
+}
+
+void ClusterExample::flow_control_test()
+{
+    flow_control_run(FLOW_LATENCY_TARGET);
+    flow_control_run(1);
+}
+
+//   Values around the zero-copy threshold, binary ones included, written with
+// CommandArgv() and read back. The async SETs of the large values are 
+// written from 'values' while they are in flight.
+void ClusterExample::argv_test()
+{
+    std::vector<std::string> values;
+    values.push_back(std::string());
+    values.push_back(std::string("a b\0c\r\n", 7));
+    values.push_back(std::string(ArgvCommand::ZEROCOPY_THRESHOLD - 1, 'x'));
+    values.push_back(std::string(ArgvCommand::ZEROCOPY_THRESHOLD, 'y'));
+    values.push_back(std::string(ARGV_LARGE_VALUE_SIZE, 'z'));
+    values.back()[ARGV_LARGE_VALUE_SIZE / 2] = '\0';
+
+    Cluster *cluster = new Cluster(IP, PORT3, TIMEOUT, TIMEOUT, DEBUG_MODE);
+    if (cluster->Connect() == false) {
+        std::cout << "[argv | connection failed]" << std::endl;
+        delete cluster;
+        return;
+    }
+    std::string output;
+    for (size_t i = 0; i < values.size(); i++) {
+        std::string key = "argv:" + std::to_string(i);
+        std::string_view argv[3] = { "SET", key, values[i] };
+        ArgvCommand argvCmd(3, argv);
+        redisReply *reply = cluster->CommandArgv(key, 3, argv);
+        bool same = reply && reply->type == REDIS_REPLY_STATUS &&
+                    cluster->Get(std::string_view(key), output) && output == values[i];
+        freeReplyObject(reply);
+        std::cout << "[argv | sync | value size: " << values[i].size()
+                  << " | " << (argvCmd.IsZeroCopy() ? "writev" : "copied")
+                  << " | " << (same ? "OK" : "MISMATCH") << "]\n";
+    }
+    delete cluster;
+
+    struct event_base *base = event_base_new();
+    AsyncCluster *asyncCluster = new AsyncCluster(IP, PORT3, TIMEOUT, TIMEOUT, base, 
+                                                  new TestRunAsyncClusterCallback(count_on_command));
+    asyncCluster->Connect();
+    count_reset(values.size() * 2);
+    for (size_t i = 0; i < values.size(); i++) {
+        std::string key = "argv:async:" + std::to_string(i);
+        std::string_view argv[3] = { "SET", key, values[i] };
+        count_issued(asyncCluster->CommandArgv(key, NULL, 3, argv));
+        // on the same connection, so read after the SET
+        count_issued(asyncCluster->Get(std::string_view(key), &values[i]));
+    }
+    if (_countDone < _countTarget) {
+        event_base_dispatch(base);
+    }
+    std::cout << "[argv | async | values: " << values.size() 
+              << " | failed: " << _countFailed << "]\n";
+
+    delete asyncCluster;
+    event_base_free(base);
+}
+
+// a GET of the arena run, the ones with 'retained' keep their reply
+struct ArenaGet {
+    const std::string *value;
+    RetainedReply **retained;
+};
+
+static void arena_on_command(redisReply *reply, void *self, void *privdata)
+{
+    ArenaGet *get = (ArenaGet *)privdata;
+    if (get && get->retained && reply) {
+        *get->retained = ((AsyncCluster *)self)->RetainReply(reply);
+    }
+    count_on_command(reply, self, get ? (void *)get->value : NULL);
+}
+
+//   Every reply is parsed into the arena of its connection, which is reset 
+// once the reply is handled. The retained replies are kept past that: they 
+// must still hold their value after all the later replies went through the
+// same arena.
+void ClusterExample::reply_arena_test()
+{
+    struct event_base *base = event_base_new();
+    AsyncCluster *asyncCluster = new AsyncCluster(IP, PORT3, TIMEOUT, TIMEOUT, base, 
+                                                  new TestRunAsyncClusterCallback(arena_on_command));
+    asyncCluster->SetReplyArena(true);
+    asyncCluster->Connect();
+
+    std::vector<std::string> values(ARENA_KEYS);
+    std::vector<RetainedReply *> retained(ARENA_KEYS, (RetainedReply *)NULL);
+    std::vector<ArenaGet> gets(ARENA_KEYS * 2);
+    count_reset(ARENA_KEYS * 3);
+    for (long int i = 0; i < ARENA_KEYS; i++) {
+        std::string key = "arena:" + std::to_string(i);
+        values[i] = "arena value " + std::to_string(i);
+        gets[i * 2].value = &values[i];
+        gets[i * 2].retained = &retained[i];
+        // only valid during the callback
+        gets[i * 2 + 1].value = &values[i];
+        gets[i * 2 + 1].retained = NULL;
+        count_issued(asyncCluster->Set(key, values[i]));
+        count_issued(asyncCluster->Get(std::string_view(key), &gets[i * 2]));
+        count_issued(asyncCluster->Get(std::string_view(key), &gets[i * 2 + 1]));
+    }
+    if (_countDone < _countTarget) {
+        event_base_dispatch(base);
+    }
+
+    long int kept = 0;
+    long int intact = 0;
+    for (long int i = 0; i < ARENA_KEYS; i++) {
+        if (retained[i] == NULL) {
+            continue;
+        }
+        kept++;
+        redisReply *reply = retained[i]->GetReply();
+        if (reply->type == REDIS_REPLY_STRING && 
+                std::string(reply->str, reply->len) == values[i]) {
+            intact++;
+        }
+        delete retained[i];
+    }
+    std::cout << "[reply arena | GET: " << ARENA_KEYS * 2
+              << " | retained: " << kept
+              << " | intact after reset: " << intact
+              << " | failed: " << _countFailed << "]\n";
+
+    delete asyncCluster;
+    event_base_free(base);
+}
+
 ////////////////////STRESS ASYNC REDIS CLUSTER API TESTS////////////////////////
 
+static double elapsed_usec(const timeval &start, const timeval &end)
+{
+    return (end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_usec - start.tv_usec);
+}
+
 void ClusterExample::stress_cluster_test()
 {
     if (_cluster == NULL) {
@@ -139,6 +748,7 @@ void ClusterExample::stress_cluster_test()
     }
 
     char key[_TESTCASES + 1];
+    _cluster->SetRespReader(RESP_READER_MODE);
     if (_cluster->Connect()) {
         std::cout << "Connection Sccuessed." << std::endl;
     }
@@ -149,6 +759,443 @@ void ClusterExample::stress_cluster_test()
     _cluster->DisConnect();
 }
 
+static void codec_stress_run(Cluster *cluster, const std::string &value, bool codec)
+{
+    ValueCompressor compressor;
+    if (codec) {
+        compressor.AddRule("json:", Lz4Codec::GetInstance());
+    }
+    cluster->SetCompressor(&compressor);
+
+    char key[32];
+    std::string output;
+    long int failed = 0;
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (long int i = 0; i < _TESTCASES; i++) {
+        sprintf(key, "json:%ld", i);
+        if (!cluster->Set(std::string_view(key), std::string_view(value)) || 
+            !cluster->Get(std::string_view(key), output) || output != value) {
+            failed++;
+        }
+    }
+    gettimeofday(&end, NULL);
+    cluster->SetCompressor(NULL);
+
+    double sec = elapsed_usec(start, end) / 1000000;
+    std::cout << "[codec | " << (codec ? "on " : "off") 
+              << " | SET+GET: " << _TESTCASES 
+              << " | failed: " << failed
+              << " | value bytes: " << compressor.GetRawBytes()
+              << " | bytes on the wire: " << compressor.GetWireBytes()
+              << " | average per second: " << _TESTCASES / sec 
+              << " | MB/s: " << compressor.GetRawBytes() / sec / 1000000 << "]\n";
+}
+
+void ClusterExample::stress_codec_test()
+{
+    if (_cluster == NULL) {
+        _cluster = new Cluster(IP, PORT3, TIMEOUT, DEBUG_MODE);
+    }
+    if (_cluster->Connect() == false) {
+        return;
+    }
+
+    // JSON-like document of about CODEC_VALUE_SIZE bytes
+    std::string value = "[";
+    for (int i = 0; value.length() < CODEC_VALUE_SIZE; i++) {
+        value += "{\"id\":" + std::to_string(i) + 
+                 ",\"name\":\"GeForce_RTX_30" + std::to_string(i % 10) + 
+                 "0\",\"price\":" + std::to_string(900 + i * 7 % 2000) + 
+                 ",\"in_stock\":" + (i % 3 ? "true" : "false") + "},";
+    }
+    value.back() = ']';
+
+    codec_stress_run(_cluster, value, false);
+    codec_stress_run(_cluster, value, true);
+    _cluster->DisConnect();
+}
+
+void ClusterExample::stress_concurrent_cluster_test()
+{
+    ConcurrentCluster cluster(IP, PORT3, CONCURRENT_CONNECTIONS, TIMEOUT, TIMEOUT, DEBUG_MODE);
+    cluster.SetRespReader(RESP_READER_MODE);
+    if (cluster.Connect() == false) {
+        std::cout << "[ConcurrentCluster | connection failed]" << std::endl;
+        return;
+    }
+
+    std::atomic<long int> failed(0);
+    std::vector<std::thread> threads;
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (int t = 0; t < CONCURRENT_THREADS; t++) {
+        threads.push_back(std::thread([&cluster, &failed, t]() {
+            char key[32];
+            std::string output;
+            for (long int i = t; i < _TESTCASES; i += CONCURRENT_THREADS) {
+                sprintf(key, "%ld", i);
+                if (!cluster.Set(std::string_view(key), std::string_view(key)) || 
+                    !cluster.Get(std::string_view(key), output) || output != key) {
+                    failed++;
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+    gettimeofday(&end, NULL);
+
+    double sec = elapsed_usec(start, end) / 1000000;
+    std::cout << "[ConcurrentCluster | threads: " << CONCURRENT_THREADS
+              << " | connections per node: " << CONCURRENT_CONNECTIONS
+              << " | SET+GET: " << _TESTCASES
+              << " | failed: " << failed.load()
+              << " | refreshes: " << cluster.GetRefreshCount()
+              << " | average per second: " << _TESTCASES / sec << "]\n";
+    cluster.PrintStats();
+}
+
+void ClusterExample::shared_topology_test()
+{
+    std::vector<Cluster *> clusters;
+    for (int i = 0; i < SHARED_TOPOLOGY_CLIENTS; i++) {
+        Cluster *cluster = new Cluster(IP, PORT3, TIMEOUT, TIMEOUT, DEBUG_MODE);
+        cluster->SetSharedTopology(true);
+        if (cluster->Connect() == false) {
+            std::cout << "[shared topology | connection failed]" << std::endl;
+            delete cluster;
+            break;
+        }
+        clusters.push_back(cluster);
+    }
+
+    char key[32];
+    std::string output;
+    long int failed = 0;
+    for (long int i = 0; i < _TESTCASES && clusters.empty() == false; i++) {
+        Cluster *cluster = clusters[i % clusters.size()];
+        sprintf(key, "%ld", i);
+        if (!cluster->Set(std::string_view(key), std::string_view(key)) || 
+            !cluster->Get(std::string_view(key), output) || output != key) {
+            failed++;
+        }
+    }
+
+    // one CLUSTER SLOTS for every client
+    if (clusters.empty() == false) {
+        SharedTopology *topology = clusters[0]->GetPool()->GetTopology();
+        std::cout << "[shared topology | clients: " << clusters.size()
+                  << " | version: " << topology->GetVersion()
+                  << " | refreshes: " << topology->GetRefreshCount()
+                  << " | failed: " << failed << "]\n";
+    }
+    for (size_t i = 0; i < clusters.size(); i++) {
+        delete clusters[i];
+    }
+}
+
+static std::atomic<long int> _shardedDone;
+static std::atomic<long int> _shardedFailed;
+
+// runs on the loop thread of the shard, or on a worker of its executor
+static void sharded_on_command(redisReply *reply, void *, void *)
+{
+    if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
+        _shardedFailed++;
+    }
+    _shardedDone++;
+}
+
+// with 'workers', the callbacks run on a CallbackExecutor shared by the loops
+static void sharded_stress_run(int loops, int workers)
+{
+    ShardedAsyncCluster sharded(IP, PORT3, TIMEOUT, TIMEOUT, loops, SHARD_BY_SLOT, true);
+    CallbackExecutor *executor = workers ? new CallbackExecutor(workers) : NULL;
+    for (int i = 0; i < loops; i++) {
+        sharded.GetShard(i)->SetCallback(new TestRunAsyncClusterCallback(sharded_on_command));
+        sharded.GetShard(i)->SetCallbackExecutor(executor);
+    }
+    if (sharded.Start() == false) {
+        std::cout << "[ShardedAsyncCluster | connection failed]" << std::endl;
+        delete executor;
+        return;
+    }
+
+    _shardedDone = 0;
+    _shardedFailed = 0;
+    std::vector<std::thread> producers;
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    for (int t = 0; t < SHARDED_PRODUCERS; t++) {
+        producers.push_back(std::thread([&sharded, t]() {
+            char key[32];
+            for (long int i = t; i < _TESTCASES; i += SHARDED_PRODUCERS) {
+                sprintf(key, "%ld", i);
+                if (sharded.Set(std::string_view(key), std::string_view(key)) == false) {
+                    _shardedFailed++;
+                    _shardedDone++;
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < producers.size(); t++) {
+        producers[t].join();
+    }
+    while (_shardedDone.load() < _TESTCASES) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    gettimeofday(&end, NULL);
+    sharded.Stop();
+    uint64_t steals = 0;
+    if (executor) {
+        executor->Stop();
+        steals = executor->GetStealCount();
+        delete executor;
+    }
+
+    // submissions per eventfd wakeup
+    uint64_t wakeups = 0, batches = 0, full = 0;
+    for (int i = 0; i < loops; i++) {
+        wakeups += sharded.GetSubmitQueue(i)->GetWakeupCount();
+        batches += sharded.GetSubmitQueue(i)->GetBatchCount();
+        full += sharded.GetSubmitQueue(i)->GetFullCount();
+    }
+
+    double sec = elapsed_usec(start, end) / 1000000;
+    std::cout << "[ShardedAsyncCluster | loops: " << loops
+              << " | workers: " << workers
+              << " | steals: " << steals
+              << " | SET: " << _TESTCASES
+              << " | failed: " << _shardedFailed.load()
+              << " | queue full: " << full
+              << " | wakeups: " << wakeups
+              << " | batches: " << batches
+              << " | average per second: " << _TESTCASES / sec << "]\n";
+}
+
+void ClusterExample::stress_sharded_async_test()
+{
+    unsigned int cores = std::thread::hardware_concurrency();
+    for (int loops = 1; loops <= SHARDED_MAX_LOOPS; loops *= 2) {
+        if (cores && (unsigned int)loops > cores) {
+            break;
+        }
+        sharded_stress_run(loops, 0);
+        sharded_stress_run(loops, SHARDED_WORKERS);
+    }
+}
+
+static long int _stripedDone;
+static long int _stripedFailed;
+
+static void striped_on_command(redisReply *reply, void *self, void *)
+{
+    if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
+        _stripedFailed++;
+    }
+    if (++_stripedDone == _TESTCASES) {
+        event_base_loopbreak(((AsyncCluster *)self)->GetEvBase());
+    }
+}
+
+static void striped_stress_run(uint32_t connections)
+{
+    struct event_base *base = event_base_new();
+    AsyncCluster *asyncCluster = new AsyncCluster(IP, PORT3, TIMEOUT, TIMEOUT, base, 
+                                                  new TestRunAsyncClusterCallback(striped_on_command));
+    asyncCluster->SetConnectionsPerNode(connections);
+    asyncCluster->Connect();
+
+    _stripedDone = 0;
+    _stripedFailed = 0;
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    char key[32];
+    for (long int i = 0; i < _TESTCASES; i++) {
+        sprintf(key, "%ld", i);
+        if (asyncCluster->Set(std::string_view(key), std::string_view(key)) == false) {
+            _stripedFailed++;
+            _stripedDone++;
+        }
+    }
+    if (_stripedDone < _TESTCASES) {
+        event_base_dispatch(base);
+    }
+    gettimeofday(&end, NULL);
+
+    double sec = elapsed_usec(start, end) / 1000000;
+    std::cout << "[AsyncCluster | connections per node: " << connections
+              << " | SET: " << _TESTCASES
+              << " | failed: " << _stripedFailed
+              << " | average per second: " << _TESTCASES / sec << "]\n";
+
+    delete asyncCluster;
+    event_base_free(base);
+}
+
+void ClusterExample::stress_striped_async_test()
+{
+    for (uint32_t connections = 1; connections <= STRIPED_MAX_CONNECTIONS; connections *= 2) {
+        striped_stress_run(connections);
+    }
+}
+
+// interactive GETs are sent one at a time, each timed, while the bulk lane
+// keeps its flow control budget of large SETs on the wire
+static std::vector<double> _probeLatency;
+static timeval _probeStart;
+static std::string _bulkValue;
+static long int _bulkDone;
+static long int _bulkSent;
+
+static void priority_send_bulk(AsyncCluster *asyncCluster)
+{
+    AsyncClusterPriority priority(asyncCluster, PRIORITY_BULK);
+    char key[32];
+    while (_probeLatency.size() < PRIORITY_PROBES) {
+        sprintf(key, "bulk:%ld", _bulkSent);
+        // COMMAND_QUEUEFULL, refilled by the next completion
+        if (asyncCluster->Set(std::string_view(key), std::string_view(_bulkValue)) == false) {
+            break;
+        }
+        _bulkSent++;
+    }
+}
+
+static void priority_send_probe(AsyncCluster *asyncCluster)
+{
+    char key[32];
+    sprintf(key, "%zu", _probeLatency.size());
+    gettimeofday(&_probeStart, NULL);
+    asyncCluster->Get(std::string_view(key), (void *)"probe");
+}
+
+static void priority_on_command(redisReply *, void *self, void *privdata)
+{
+    AsyncCluster *asyncCluster = (AsyncCluster *)self;
+    if (privdata == NULL) {
+        _bulkDone++;
+        priority_send_bulk(asyncCluster);
+    } else {
+        timeval now;
+        gettimeofday(&now, NULL);
+        _probeLatency.push_back(elapsed_usec(_probeStart, now));
+        if (_probeLatency.size() < PRIORITY_PROBES) {
+            priority_send_probe(asyncCluster);
+        }
+    }
+
+    // the bulk SETs still on the wire are drained first
+    if (_probeLatency.size() >= PRIORITY_PROBES && _bulkDone == _bulkSent) {
+        event_base_loopbreak(asyncCluster->GetEvBase());
+    }
+}
+
+static void priority_lanes_run(bool lanes)
+{
+    struct event_base *base = event_base_new();
+    AsyncCluster *asyncCluster = new AsyncCluster(IP, PORT3, TIMEOUT, TIMEOUT, base, 
+                                                  new TestRunAsyncClusterCallback(priority_on_command));
+    asyncCluster->SetPriorityLanes(lanes);
+    FlowControlOptions bulk;
+    bulk.maxInflight = PRIORITY_BULK_INFLIGHT;
+    asyncCluster->SetFlowControl(bulk, PRIORITY_BULK);
+    asyncCluster->Connect();
+
+    _probeLatency.clear();
+    _bulkValue.assign(PRIORITY_BULK_VALUE_SIZE, 'b');
+    _bulkDone = 0;
+    _bulkSent = 0;
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    priority_send_bulk(asyncCluster);
+    priority_send_probe(asyncCluster);
+    event_base_dispatch(base);
+    gettimeofday(&end, NULL);
+
+    std::sort(_probeLatency.begin(), _probeLatency.end());
+    size_t count = _probeLatency.size();
+    double sec = elapsed_usec(start, end) / 1000000;
+    std::cout << "[priority lanes | " << (lanes ? "on " : "off")
+              << " | GET: " << count
+              << " | p50: " << (count ? _probeLatency[count / 2] : 0) << "us"
+              << " | p99: " << (count ? _probeLatency[count * 99 / 100] : 0) << "us"
+              << " | bulk SET per second: " << _bulkDone / sec << "]\n";
+
+    delete asyncCluster;
+    event_base_free(base);
+}
+
+void ClusterExample::priority_lanes_test()
+{
+    priority_lanes_run(false);
+    priority_lanes_run(true);
+}
+
+#ifdef REDIS_CLUSTER_COROUTINE
+static long int _coroutineDone;
+static long int _coroutineFailed;
+
+// read-modify-write of a counter, one GET and one SET per round
+static ClusterTask coroutine_counter(AsyncCluster &asyncCluster, std::string key, int rounds)
+{
+    for (int i = 0; i < rounds; i++) {
+        CommandResult value = co_await AwaitGet(asyncCluster, key);
+        if (value.is_ok() == false) {
+            _coroutineFailed++;
+            break;
+        }
+        long int counter = value.is_nil() ? 0 : atol(std::string(value.GetString()).c_str());
+        std::string next = std::to_string(counter + 1);
+        CommandResult stored = co_await AwaitSet(asyncCluster, key, next);
+        if (stored.is_ok() == false) {
+            _coroutineFailed++;
+            break;
+        }
+    }
+    if (++_coroutineDone == COROUTINE_TASKS) {
+        event_base_loopbreak(asyncCluster.GetEvBase());
+    }
+}
+#endif
+
+void ClusterExample::coroutine_test()
+{
+#ifdef REDIS_CLUSTER_COROUTINE
+    struct event_base *base = event_base_new();
+    AsyncCluster *asyncCluster = new AsyncCluster(IP, PORT3, TIMEOUT, TIMEOUT, base, NULL);
+    asyncCluster->SetSlabAllocation(true);
+    asyncCluster->Connect();
+
+    _coroutineDone = 0;
+    _coroutineFailed = 0;
+    timeval start, end;
+    gettimeofday(&start, NULL);
+    char key[32];
+    for (int i = 0; i < COROUTINE_TASKS; i++) {
+        sprintf(key, "coroutine:%d", i);
+        coroutine_counter(*asyncCluster, key, COROUTINE_ROUNDS);
+    }
+    event_base_dispatch(base);
+    gettimeofday(&end, NULL);
+
+    double sec = elapsed_usec(start, end) / 1000000;
+    std::cout << "[coroutine | tasks: " << COROUTINE_TASKS
+              << " | rounds: " << COROUTINE_ROUNDS
+              << " | failed: " << _coroutineFailed
+              << " | frame heap allocations: " << asyncCluster->GetFramePool()->GetHeapCount()
+              << " | commands per second: " 
+              << COROUTINE_TASKS * COROUTINE_ROUNDS * 2 / sec << "]\n";
+
+    delete asyncCluster;
+    event_base_free(base);
+#else
+    std::cout << "[coroutine | needs C++20]" << std::endl;
+#endif
+}
+
 void ClusterExample::stress_async_cluster_test()
 {
     if (_ev_base == NULL) {
@@ -159,12 +1206,373 @@ void ClusterExample::stress_async_cluster_test()
     }
 
     _asyncCluster->SetCallback(new TestStressAsyncClusterCallback());
+    _asyncCluster->SetSlabAllocation(SLAB_MODE);
+    _asyncCluster->SetRespReader(RESP_READER_MODE);
     _asyncCluster->Connect();
     if (event_base_dispatch(_ev_base) == -1) {
         std::cout << "[event_base_dispatch error]" << std::endl;
     }
 }
 
+static void stream_on_connect(const redisAsyncContext *context, int)
+{
+    static bool only_test_one_time = true;
+    if (only_test_one_time == false) {
+        return;
+    } 
+    only_test_one_time = false;
+
+    AsyncCluster *cluster = (AsyncCluster *)context->data;
+    _streamer = new ValueStreamer(cluster);
+
+    gettimeofday(&_start, NULL);
+    if (_streamer->Write("stream_value", new TestStreamSource()) == false) {
+        std::cout << "[stream | write failed]\n";
+        event_base_loopbreak(cluster->GetEvBase());
+    }
+}
+
+// parked streams resume once their node has room
+static void stream_on_ready(const char *id)
+{
+    if (_streamer) {
+        _streamer->OnReady(id);
+    }
+}
+
+void ClusterExample::async_stream_test()
+{
+    if (_ev_base == NULL) {
+        _ev_base = event_base_new();
+    }
+    if (_asyncCluster == NULL) {
+        _asyncCluster = new AsyncCluster(IP, PORT3, 1, 1, _ev_base, NULL, DEBUG_MODE);
+    }
+
+    _asyncCluster->SetCallback(new TestRunAsyncClusterCallback(NULL, stream_on_connect, 
+                                                               stream_on_ready));
+    _asyncCluster->Connect();
+    if (event_base_dispatch(_ev_base) == -1) {
+        std::cout << "[event_base_dispatch error]" << std::endl;
+    }
+    delete _streamer;
+    _streamer = NULL;
+}
+
+///////////////////////// RESP FORMAT MICRO BENCHMARK ///////////////////////////
+
+static void print_format_result(const char *shape, double printfUsec, double respUsec)
+{
+    std::cout << "[format | " << shape
+              << " | redisFormatCommand: " << printfUsec * 1000 / _TESTCASES << "ns"
+              << " | RespCommand: " << respUsec * 1000 / _TESTCASES << "ns"
+              << " | speedup: " << printfUsec / respUsec << "x]\n";
+}
+
+void ClusterExample::resp_format_benchmark()
+{
+    const char *key = "GeForce_RTX_3060";
+    const char *val = "$900";
+    const char *field = "price";
+    const char *score = "3060";
+    timeval start, end;
+    double printfUsec, respUsec;
+    char *cmd;
+    long int bytes = 0;
+
+    // GET
+    gettimeofday(&start, NULL);
+    for (long int i = 0; i < _TESTCASES; i++) {
+        bytes += redisFormatCommand(&cmd, "GET %s", key);
+        free(cmd);
+    }
+    gettimeofday(&end, NULL);
+    printfUsec = elapsed_usec(start, end);
+    gettimeofday(&start, NULL);
+    for (long int i = 0; i < _TESTCASES; i++) {
+        bytes += RespGet::Format(&cmd, key);
+        free(cmd);
+    }
+    gettimeofday(&end, NULL);
+    respUsec = elapsed_usec(start, end);
+    print_format_result("GET", printfUsec, respUsec);
+
+    // SET
+    gettimeofday(&start, NULL);
+    for (long int i = 0; i < _TESTCASES; i++) {
+        bytes += redisFormatCommand(&cmd, "SET %s %s", key, val);
+        free(cmd);
+    }
+    gettimeofday(&end, NULL);
+    printfUsec = elapsed_usec(start, end);
+    gettimeofday(&start, NULL);
+    for (long int i = 0; i < _TESTCASES; i++) {
+        bytes += RespSet::Format(&cmd, key, val);
+        free(cmd);
+    }
+    gettimeofday(&end, NULL);
+    respUsec = elapsed_usec(start, end);
+    print_format_result("SET", printfUsec, respUsec);
+
+    // HSET
+    gettimeofday(&start, NULL);
+    for (long int i = 0; i < _TESTCASES; i++) {
+        bytes += redisFormatCommand(&cmd, "HSET %s %s %s", key, field, val);
+        free(cmd);
+    }
+    gettimeofday(&end, NULL);
+    printfUsec = elapsed_usec(start, end);
+    gettimeofday(&start, NULL);
+    for (long int i = 0; i < _TESTCASES; i++) {
+        bytes += RespHSet::Format(&cmd, key, field, val);
+        free(cmd);
+    }
+    gettimeofday(&end, NULL);
+    respUsec = elapsed_usec(start, end);
+    print_format_result("HSET", printfUsec, respUsec);
+
+    // ZADD
+    gettimeofday(&start, NULL);
+    for (long int i = 0; i < _TESTCASES; i++) {
+        bytes += redisFormatCommand(&cmd, "ZADD %s %s %s", key, score, val);
+        free(cmd);
+    }
+    gettimeofday(&end, NULL);
+    printfUsec = elapsed_usec(start, end);
+    gettimeofday(&start, NULL);
+    for (long int i = 0; i < _TESTCASES; i++) {
+        bytes += RespZAdd::Format(&cmd, key, score, val);
+        free(cmd);
+    }
+    gettimeofday(&end, NULL);
+    respUsec = elapsed_usec(start, end);
+    print_format_result("ZADD", printfUsec, respUsec);
+
+    // keeps the loops from being optimized away
+    std::cout << "[format | total bytes: " << bytes << "]\n";
+}
+
+///////////////////////// RESP READER MICRO BENCHMARK ///////////////////////////
+
+static std::string resp_bulk(const std::string &str)
+{
+    return "$" + std::to_string(str.length()) + "\r\n" + str + "\r\n";
+}
+
+static void print_reader_result(const char *shape, 
+                                size_t bytes, 
+                                double hiredisUsec, 
+                                double respUsec)
+{
+    std::cout << "[reader | " << shape << " (" << bytes << " bytes)"
+              << " | hiredis: " << hiredisUsec * 1000 / _TESTCASES << "ns"
+              << " | RespReader: " << respUsec * 1000 / _TESTCASES << "ns"
+              << " | speedup: " << hiredisUsec / respUsec << "x]\n";
+}
+
+static void reader_benchmark(const char *shape, const std::string &payload)
+{
+    timeval start, end;
+    double hiredisUsec, respUsec;
+    void *reply;
+
+    redisReader *hiredisReader = redisReaderCreate();
+    gettimeofday(&start, NULL);
+    for (long int i = 0; i < _TESTCASES; i++) {
+        redisReaderFeed(hiredisReader, payload.data(), payload.length());
+        redisReaderGetReply(hiredisReader, &reply);
+        freeReplyObject(reply);
+    }
+    gettimeofday(&end, NULL);
+    hiredisUsec = elapsed_usec(start, end);
+    redisReaderFree(hiredisReader);
+
+    RespReader respReader;
+    gettimeofday(&start, NULL);
+    for (long int i = 0; i < _TESTCASES; i++) {
+        respReader.Feed(payload.data(), payload.length());
+        respReader.GetReply(&reply);
+        freeReplyObject(reply);
+    }
+    gettimeofday(&end, NULL);
+    respUsec = elapsed_usec(start, end);
+
+    print_reader_result(shape, payload.length(), hiredisUsec, respUsec);
+}
+
+void ClusterExample::resp_reader_benchmark()
+{
+    std::string payload;
+
+    // GET of a 512 bytes value
+    reader_benchmark("GET", resp_bulk(std::string(512, 'v')));
+
+    // MGET of 100 keys
+    payload = "*100\r\n";
+    for (int i = 0; i < 100; i++) {
+        payload += resp_bulk("value:" + std::to_string(i));
+    }
+    reader_benchmark("MGET", payload);
+
+    // HGETALL of 1000 fields
+    payload = "*2000\r\n";
+    for (int i = 0; i < 1000; i++) {
+        payload += resp_bulk("field:" + std::to_string(i));
+        payload += resp_bulk(std::string(32, 'v'));
+    }
+    reader_benchmark("HGETALL", payload);
+
+    // CLUSTER SLOTS of 3 masters with one replica each
+    payload = "*3\r\n";
+    for (int i = 0; i < 3; i++) {
+        payload += "*4\r\n:" + std::to_string(i * 5461) + "\r\n:" + 
+                   std::to_string(i * 5461 + 5460) + "\r\n";
+        for (int j = 0; j < 2; j++) {
+            payload += "*3\r\n" + resp_bulk(IP) + ":" + 
+                       std::to_string(PORT1 + i * 2 + j) + "\r\n" + 
+                       resp_bulk(std::string(40, 'a' + i * 2 + j));
+        }
+    }
+    reader_benchmark("CLUSTER SLOTS", payload);
+}
+
+///////////////////////// RESP READER FUZZ TEST ///////////////////////////
+
+static std::string fuzz_string(bool binary)
+{
+    std::string str;
+    int len = rand() % 4 == 0 ? rand() % 200 : rand() % 16;
+    for (int i = 0; i < len; i++) {
+        str += binary ? (char)(rand() % 256) : (char)(' ' + rand() % 95);
+    }
+    return str;
+}
+
+static std::string fuzz_value(int depth)
+{
+    static const char *doubles[] = {
+        "1.5", "-0.25", "3e10", "inf", "-inf", "nan", "1e400", "abc", ""
+    };
+    static const char *integers[] = {
+        "0", "-1", "42", "9223372036854775807", "-9223372036854775808", 
+        "9223372036854775808", "007", "-0", "+1", ""
+    };
+    int type = rand() % (depth < 4 ? 16 : 11);
+
+    switch (type) {
+    case 0: return "+" + fuzz_string(false) + "\r\n";
+    case 1: return "-ERR " + fuzz_string(false) + "\r\n";
+    case 2: return ":" + std::string(integers[rand() % 10]) + "\r\n";
+    case 3: return ":" + std::to_string(rand() - RAND_MAX / 2) + "\r\n";
+    case 4: return resp_bulk(fuzz_string(true));
+    case 5: return "$-1\r\n";
+    case 6: return "," + std::string(doubles[rand() % 9]) + "\r\n";
+    case 7: return rand() % 8 ? "_\r\n" : "_x\r\n";
+    case 8: return "#" + std::string(1, "tTfFx"[rand() % 5]) + "\r\n";
+    case 9: return "(" + std::to_string(rand()) + "123456789012345678901\r\n";
+    case 10: {
+        std::string str = (rand() % 8 ? "txt:" : "txt") + fuzz_string(true);
+        return "=" + std::to_string(str.length()) + "\r\n" + str + "\r\n";
+    }
+    default: {
+        const char *prefix = "*%~>*";
+        int elements = rand() % 8 == 0 ? -1 : rand() % 6;
+        std::string str = prefix[type - 11] + std::to_string(elements) + "\r\n";
+        if (prefix[type - 11] == '%') {
+            elements *= 2;
+        }
+        for (int i = 0; i < elements; i++) {
+            str += fuzz_value(depth + 1);
+        }
+        return str;
+    }
+    }
+}
+
+static bool same_reply(const redisReply *a, const redisReply *b)
+{
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+    if (a->type != b->type || a->integer != b->integer || 
+        a->len != b->len || a->elements != b->elements) {
+        return false;
+    }
+    if (a->dval != b->dval && !(std::isnan(a->dval) && std::isnan(b->dval))) {
+        return false;
+    }
+    if (a->len && memcmp(a->str, b->str, a->len) != 0) {
+        return false;
+    }
+    if (a->type == REDIS_REPLY_VERB && memcmp(a->vtype, b->vtype, 3) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < a->elements; i++) {
+        if (!same_reply(a->element[i], b->element[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ClusterExample::resp_reader_fuzz_test()
+{
+    unsigned int seed = (unsigned int)time(NULL);
+    long int mismatches = 0;
+    long int replies = 0;
+    srand(seed);
+
+    for (long int i = 0; i < _TESTCASES; i++) {
+        std::string payload;
+        int values = 1 + rand() % 4;
+        for (int j = 0; j < values; j++) {
+            payload += fuzz_value(0);
+        }
+        // corrupts one byte now and then
+        if (rand() % 10 == 0) {
+            payload[rand() % payload.length()] = (char)(rand() % 256);
+        }
+
+        redisReader *hiredisReader = redisReaderCreate();
+        RespReader respReader;
+        size_t offset = 0;
+        bool failed = false;
+
+        while (offset < payload.length() && !failed) {
+            size_t len = 1 + rand() % (payload.length() - offset);
+            redisReaderFeed(hiredisReader, payload.data() + offset, len);
+            respReader.Feed(payload.data() + offset, len);
+            offset += len;
+
+            while (true) {
+                void *a = NULL;
+                void *b = NULL;
+                int ra = redisReaderGetReply(hiredisReader, &a);
+                int rb = respReader.GetReply(&b);
+                bool same = (ra == rb) && same_reply((redisReply *)a, (redisReply *)b);
+                if (a) freeReplyObject(a);
+                if (b) freeReplyObject(b);
+                if (!same) {
+                    mismatches++;
+                    failed = true;
+                    std::cout << "[fuzz | mismatch | seed: " << seed 
+                              << " | case: " << i << "]\n";
+                }
+                if (!same || ra != REDIS_OK || a == NULL) {
+                    failed = failed || ra != REDIS_OK;
+                    break;
+                }
+                replies++;
+            }
+        }
+        redisReaderFree(hiredisReader);
+    }
+
+    std::cout << "[fuzz | seed: " << seed << " | cases: " << _TESTCASES 
+              << " | replies: " << replies 
+              << " | mismatches: " << mismatches << "]\n";
+}
+
 //////////////////////// TEST ASYNC CLUSTER CALLBACK ///////////////////////////
 
 void ClusterExample::async_cluster_set_test(AsyncCluster *asyncCluster, 
@@ -335,8 +1743,64 @@ void TestStressAsyncClusterCallback::OnCommand(redisReply *reply,
                   << elapsed
                   << "s | average per second: "
                   << (double)(count / elapsed) << "]\n";
+        std::cout << "[async | slab: "
+                  << (SLAB_MODE ? "on" : "off")
+                  << " | slabs: "
+                  << (cluster->GetSlab() ? cluster->GetSlab()->GetSlabCount() : 0)
+                  << "]\n";
         event_base_loopbreak(cluster->GetEvBase());
     }
 }
 
-} // RedisClusterAPI
+///////////////////////// TEST VALUE STREAMING ///////////////////////////
+
+size_t TestStreamSource::Read(char *buf, size_t size)
+{
+    size_t len = 0;
+    while (len < size && _offset < STREAM_VALUE_SIZE) {
+        buf[len++] = 'a' + _offset++ % 26;
+    }
+    return len;
+}
+
+void TestStreamSource::OnDone(int status, uint64_t bytes)
+{
+    gettimeofday(&_end, NULL);
+    std::cout << "[stream | write: " << (status == REDIS_OK ? "OK" : "FAILED")
+              << " | bytes: " << bytes 
+              << " | chunks: " << _streamer->GetChunkCount()
+              << " | Execution time: " << elapsed_usec(_start, _end) / 1000000 
+              << "s]\n";
+    delete this;
+
+    gettimeofday(&_start, NULL);
+    if (status != REDIS_OK || 
+        _streamer->Read("stream_value", new TestStreamSink()) == false) {
+        event_base_loopbreak(_streamer->GetAsyncCluster()->GetEvBase());
+    }
+}
+
+void TestStreamSink::Write(std::string_view chunk)
+{
+    for (size_t i = 0; i < chunk.length(); i++) {
+        if (chunk[i] != 'a' + (char)((_offset + i) % 26)) {
+            _mismatch = true;
+        }
+    }
+    _offset += chunk.length();
+}
+
+void TestStreamSink::OnDone(int status, uint64_t bytes)
+{
+    gettimeofday(&_end, NULL);
+    std::cout << "[stream | read: " << (status == REDIS_OK ? "OK" : "FAILED")
+              << " | bytes: " << bytes 
+              << " | content: " << (_mismatch || bytes != STREAM_VALUE_SIZE ? 
+                                    "MISMATCH" : "OK")
+              << " | Execution time: " << elapsed_usec(_start, _end) / 1000000 
+              << "s]\n";
+    delete this;
+    event_base_loopbreak(_streamer->GetAsyncCluster()->GetEvBase());
+}
+
+} // RedisClusterAPI
\ No newline at end of file
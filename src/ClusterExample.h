@@ -5,13 +5,26 @@
 
 #include "cluster.h"
 #include "asynccluster.h"
+#include "writecombiner.h"
+#include "noreplywriter.h"
+#include "respcommand.h"
+#include "respreader.h"
+#include "valuestream.h"
+#include "concurrentcluster.h"
+#include "shardedcluster.h"
+#include "asynccoroutine.h"
+#include "asiocluster.h"
 
 #include <eventhandler.h>
 #include "event2/event.h"
 
 #include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
 #include <time.h>
 #include <cmath>
+#include <algorithm>
 
 #define TEST_CASE_temp 333333
 #define TEST_CASE_0 100
@@ -27,6 +40,36 @@
 #define TEST_PORT 8000
 #define TIMEOUT 15000
 #define DEBUG_MODE 1
+#define SLAB_MODE true
+#define RESP_READER_MODE true
+#define STREAM_VALUE_SIZE (32 * 1024 * 1024)
+#define CODEC_VALUE_SIZE 8192
+#define CONCURRENT_THREADS 16
+#define CONCURRENT_CONNECTIONS 4
+#define SHARED_TOPOLOGY_CLIENTS 32
+#define SHARDED_MAX_LOOPS 8
+#define SHARDED_PRODUCERS 4
+#define SHARDED_WORKERS 4
+#define STRIPED_MAX_CONNECTIONS 8
+#define PRIORITY_PROBES 10000
+#define PRIORITY_BULK_INFLIGHT 512
+#define PRIORITY_BULK_VALUE_SIZE 16384
+#define COROUTINE_TASKS 1000
+#define COROUTINE_ROUNDS 100
+#define ASIO_THREADS 4
+#define SINGLE_FLIGHT_CALLERS 64
+#define COMBINER_INCREMENTS 10000
+#define NOREPLY_WRITES 100000
+#define NOREPLY_CHECKPOINT_COUNT 1000
+#define NOREPLY_WAIT 10
+#define CORK_COMMANDS 1000
+#define FLOW_MIN_INFLIGHT 4
+#define FLOW_MAX_INFLIGHT 256
+#define FLOW_LATENCY_TARGET 10000
+#define ARGV_LARGE_VALUE_SIZE (1024 * 1024)
+#define ARENA_KEYS 1000
+#define UNREACHABLE_IP "10.255.255.1"
+#define SHORT_TIMEOUT 1
 
 namespace RedisClusterAPI
 {
@@ -60,6 +103,65 @@ public:
     virtual void OnCommand(redisReply *reply, void *self, void *data);
 };
 
+class TestStreamSource : public StreamSource
+{
+public:
+    TestStreamSource() : _offset(0) {}
+    virtual size_t Read(char *buf, size_t size);
+    virtual void OnDone(int status, uint64_t bytes);
+private:
+    uint64_t _offset;
+};
+
+class TestStreamSink : public StreamSink
+{
+public:
+    TestStreamSink() : _offset(0), _mismatch(false) {}
+    virtual void Write(std::string_view chunk);
+    virtual void OnDone(int status, uint64_t bytes);
+private:
+    uint64_t _offset;
+    bool _mismatch;
+};
+
+// Callback of the feature runs, every reply is passed to 'onCommand', the 
+// connect and ready events to the optional handlers.
+class TestRunAsyncClusterCallback : public AsyncClusterCallback
+{
+public:
+    typedef void (CommandFn)(redisReply *reply, void *self, void *privdata);
+    typedef void (ConnectFn)(const redisAsyncContext *context, int status);
+    typedef void (ReadyFn)(const char *id);
+public:
+    TestRunAsyncClusterCallback(CommandFn *onCommand, 
+                                ConnectFn *onConnect = NULL, 
+                                ReadyFn *onReady = NULL) 
+        : _onCommand(onCommand), _onConnect(onConnect), _onReady(onReady) {}
+    virtual void OnDisconnect(const redisAsyncContext *, int) {}
+    virtual void OnConnect(const redisAsyncContext *context, int status) 
+    {
+        if (_onConnect) {
+            _onConnect(context, status);
+        }
+    }
+    virtual void OnCommand(redisReply *reply, void *self, void *data) 
+    {
+        if (_onCommand) {
+            _onCommand(reply, self, data);
+        }
+    }
+    virtual void OnReady(const char *id) 
+    {
+        if (_onReady) {
+            _onReady(id);
+        }
+    }
+private:
+    CommandFn *_onCommand;
+    ConnectFn *_onConnect;
+    ReadyFn *_onReady;
+};
+
 class ClusterExample
 {
 public:
@@ -69,13 +171,38 @@ public:
     // sync
     void cluster_test();
     void cluster_ask_moved_test();
+    void connection_timeout_test();
     
     // async
     void async_cluster_test();
+    void single_flight_test();
+    void write_combiner_test();
+    void noreply_writer_test();
+    void cork_test();
+    void flow_control_test();
+    void argv_test();
+    void reply_arena_test();
+    void completion_handler_test();
+    void asio_cluster_test();
 
     // stress test
     void stress_cluster_test();
     void stress_async_cluster_test();
+    void async_stream_test();
+    void stress_codec_test();
+    void stress_concurrent_cluster_test();
+    void shared_topology_test();
+    void stress_sharded_async_test();
+    void stress_striped_async_test();
+    void priority_lanes_test();
+    void coroutine_test();
+
+    // micro benchmark
+    void resp_format_benchmark();
+    void resp_reader_benchmark();
+
+    // differential fuzz test against the hiredis reader
+    void resp_reader_fuzz_test();
 public:
     static void cluster_set_test(Cluster *cluster, const char *key, const char *val);
     static void cluster_get_test(Cluster *cluster,const char *key, std::string &buff);
@@ -0,0 +1,118 @@
+#include "argvcommand.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+namespace RedisClusterAPI
+{
+
+ArgvCommand::ArgvCommand(int argc, 
+                         const std::string_view *argv, 
+                         size_t threshold)
+    : _length(0), _zeroCopy(false)
+{
+    // segment of the command: [offset, len) in _buffer or a caller argument
+    struct Segment {
+        const char *ptr; 
+        size_t offset; 
+        size_t len;
+    };
+    std::vector<Segment> segments;
+    char header[32];
+    size_t start = 0;
+
+    int n = snprintf(header, sizeof(header), "*%d\r\n", argc);
+    _buffer.append(header, n);
+
+    for (int i = 0; i < argc; i++) {
+        n = snprintf(header, sizeof(header), "$%zu\r\n", argv[i].size());
+        _buffer.append(header, n);
+
+        if (argv[i].size() < threshold) {
+            _buffer.append(argv[i].data(), argv[i].size());
+            _buffer.append("\r\n", 2);
+            continue;
+        }
+
+        // close the copied part and reference the argument itself
+        segments.push_back({ NULL, start, _buffer.size() - start });
+        segments.push_back({ argv[i].data(), 0, argv[i].size() });
+        start = _buffer.size();
+        _buffer.append("\r\n", 2);
+        _zeroCopy = true;
+    }
+    segments.push_back({ NULL, start, _buffer.size() - start });
+
+    // _buffer does not change any more, it is safe to point into it
+    std::vector<Segment>::iterator it;
+    for (it = segments.begin(); it != segments.end(); it++) {
+        if (it->len == 0) {
+            continue;
+        }
+        struct iovec iov;
+        iov.iov_base = (void *)(it->ptr ? it->ptr : _buffer.data() + it->offset);
+        iov.iov_len = it->len;
+        _iov.push_back(iov);
+        _length += it->len;
+    }
+}
+
+char *ArgvCommand::Format(size_t offset)
+{
+    if (offset > _length) {
+        return NULL;
+    }
+
+    char *cmd = (char *)malloc(_length - offset + 1);
+    if (cmd == NULL) {
+        return NULL;
+    }
+
+    char *p = cmd;
+    std::vector<struct iovec>::iterator it;
+    for (it = _iov.begin(); it != _iov.end(); it++) {
+        if (offset >= it->iov_len) {
+            offset -= it->iov_len;
+            continue;
+        }
+        memcpy(p, (char *)it->iov_base + offset, it->iov_len - offset);
+        p += it->iov_len - offset;
+        offset = 0;
+    }
+    *p = '\0';
+    return cmd;
+}
+
+ssize_t ArgvCommand::Write(int fd, size_t offset)
+{
+    // skip what has already been written
+    size_t i = 0;
+    while (i < _iov.size() && offset >= _iov[i].iov_len) {
+        offset -= _iov[i].iov_len;
+        i++;
+    }
+    if (i == _iov.size()) {
+        return 0;
+    }
+
+    struct iovec iov[IOV_MAX];
+    int iovcnt = 0;
+    for (; i < _iov.size() && iovcnt < IOV_MAX; i++, iovcnt++) {
+        iov[iovcnt] = _iov[i];
+    }
+    iov[0].iov_base = (char *)iov[0].iov_base + offset;
+    iov[0].iov_len -= offset;
+
+    ssize_t nwritten = writev(fd, iov, iovcnt);
+    if (nwritten == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return 0;
+        }
+        return -1;
+    }
+    return nwritten;
+}
+
+} // RedisClusterAPI
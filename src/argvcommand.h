@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+#include <sys/uio.h>
+
+namespace RedisClusterAPI
+{
+
+// Binary-safe RESP command built from string_view arguments.
+//   Arguments shorter than 'threshold' are copied into the command, larger 
+// ones are only referenced and written with writev() straight from the 
+// caller's memory. The caller must keep every referenced argument alive until
+// the command is completed (the reply, or the error, has been delivered).
+class ArgvCommand
+{
+public:
+    ArgvCommand(int argc, 
+                const std::string_view *argv, 
+                size_t threshold = ZEROCOPY_THRESHOLD);
+    ~ArgvCommand() = default;
+    ArgvCommand(const ArgvCommand &) = delete;
+    ArgvCommand& operator=(const ArgvCommand &) = delete;
+
+    char *Format(size_t offset = 0);
+    ssize_t Write(int fd, size_t offset);
+public:
+    bool IsZeroCopy() { return _zeroCopy; }
+    size_t GetLength() { return _length; }
+    const struct iovec *GetIov() { return _iov.data(); }
+    int GetIovCount() { return (int)_iov.size(); }
+public:
+    static const size_t ZEROCOPY_THRESHOLD = 16 * 1024;
+private:
+    std::string _buffer;            // RESP headers and the copied arguments
+    std::vector<struct iovec> _iov;
+    size_t _length;
+    bool _zeroCopy;
+};
+
+} // RedisClusterAPI
@@ -3,18 +3,16 @@
 namespace RedisClusterAPI
 {
 
-// int64_t GetCurrUsec();
+int64_t GetCurrUsec();
 
 ////////////////////////////////// DATA ////////////////////////////////////////
 
-CommandData::CommandData() : cmd(NULL), key(NULL), index(-1), 
-                             cmdlen(0), retryCount(0) {}
+CommandData::CommandData() : cmd(NULL), key(NULL), keylen(0), index(-1), 
+                             cmdlen(0), retryCount(0), argv(NULL) {}
 
-CommandData::CommandData(char *c, std::string k, uint32_t idx, uint32_t len) 
-    : cmd(c), index(idx), cmdlen(len) 
-{
-    key.assign(k);
-}
+CommandData::CommandData(char *c, uint32_t idx, uint32_t len) 
+    : cmd(c), key(NULL), keylen(0), index(idx), cmdlen(len), retryCount(0),
+      argv(NULL) {}
 
 CommandData::~CommandData()
 {
@@ -22,17 +20,147 @@ CommandData::~CommandData()
         free(cmd);
         cmd = NULL;
     }
+    delete argv;
+    argv = NULL;
+}
+
+bool CommandData::Flatten()
+{
+    if (cmd || argv == NULL) {
+        return cmd != NULL;
+    }
+    cmd = argv->Format();
+    return cmd != NULL;
+}
+
+NodeFlowControl::NodeFlowControl() 
+    : options(NULL), inflight(0), inflightBytes(0), limit(0), increaseCount(0),
+      lastDecrease(0), completed(0), rejected(0), waiting(false) {}
+
+NodeFlowControl::NodeFlowControl(const FlowControlOptions *opts)
+    : options(opts), inflight(0), inflightBytes(0), limit(opts->maxInflight), 
+      increaseCount(0), lastDecrease(0), completed(0), rejected(0), 
+      waiting(false) 
+{
+    if (opts->adaptive) {
+        limit = opts->minInflight;
+    }
+}
+
+bool NodeFlowControl::IsFull(uint32_t bytes)
+{
+    if (limit > 0 && inflight >= limit) {
+        return true;
+    }
+    // a single command larger than the byte limit is let through alone
+    if (options->maxInflightBytes > 0 && inflight > 0 &&
+            inflightBytes + bytes > options->maxInflightBytes) {
+        return true;
+    }
+    return false;
+}
+
+bool NodeFlowControl::Acquire(uint32_t bytes)
+{
+    if (IsFull(bytes)) {
+        rejected++;
+        waiting = true;
+        return false;
+    }
+    inflight++;
+    inflightBytes += bytes;
+    return true;
 }
 
-AsyncClusterData::AsyncClusterData() : cmdData(NULL), privdata(NULL), err(0) {}
+// a command that was never sent, it neither completed nor tells anything
+// about the latency of the node
+void NodeFlowControl::Cancel(uint32_t bytes)
+{
+    inflight--;
+    inflightBytes -= bytes;
+}
+
+bool NodeFlowControl::Release(uint32_t bytes, 
+                              int64_t latency, 
+                              bool failed, 
+                              int64_t now)
+{
+    inflight--;
+    inflightBytes -= bytes;
+    completed++;
+
+    if (options->adaptive) {
+        bool slow = failed || 
+                    (options->latencyTarget > 0 && latency > options->latencyTarget);
+        if (!slow) {
+            // additive increase, one per window of 'limit' completions
+            if (++increaseCount >= limit) {
+                increaseCount = 0;
+                if (options->maxInflight == 0 || limit < options->maxInflight) {
+                    limit++;
+                }
+            }
+        } else if (now - lastDecrease > options->latencyTarget) {
+            // multiplicative decrease
+            lastDecrease = now;
+            increaseCount = 0;
+            limit = limit / 2 > options->minInflight ? limit / 2 : options->minInflight;
+        }
+    }
+
+    // tell the rejected callers once there is room again
+    if (waiting && !IsFull(0)) {
+        waiting = false;
+        return true;
+    }
+    return false;
+}
+
+const char *CommandData::FindKey(const char *cmd, 
+                                 uint32_t cmdlen, 
+                                 const char *key, 
+                                 uint32_t keylen)
+{
+    //   The key is one of the bulk arguments of the formatted command, the 
+    // first argument after the command name matching it is used.
+    const char *p = cmd;
+    const char *end = cmd + cmdlen;
+    bool name = true;
+
+    while (p < end && (p = (const char *)memchr(p, '$', end - p)) != NULL) {
+        uint32_t len = (uint32_t)atoi(p + 1);
+        p = (const char *)memchr(p, '\n', end - p);
+        if (p == NULL || p + 1 + len > end) {
+            return NULL;
+        }
+        p++;
+        if (!name && len == keylen && memcmp(p, key, keylen) == 0) {
+            return p;
+        }
+        name = false;
+        p += len + 2;
+    }
+    return NULL;
+}
+
+AsyncClusterData::AsyncClusterData() : cmdData(NULL), privdata(NULL), err(0),
+                                       inflight(false), followers(NULL),
+                                       flow(NULL), sendUsec(0), pooled(false),
+                                       value(false), decode(false), 
+                                       callback(NULL), 
+                                       priority(PRIORITY_INTERACTIVE) {}
 
 AsyncClusterData::AsyncClusterData(CommandData *commandData, void *data)
-    : cmdData(commandData), privdata(data), err(0) {}
+    : cmdData(commandData), privdata(data), err(0), inflight(false), 
+      followers(NULL), flow(NULL), sendUsec(0), pooled(false), value(false), 
+      decode(false), callback(NULL), priority(PRIORITY_INTERACTIVE) {}
 
 AsyncClusterData::~AsyncClusterData() 
 {
     delete cmdData; 
     cmdData = NULL;
+    delete followers;
+    followers = NULL;
 }
 
 void AsyncClusterData::SetError(int type, const char *str)
@@ -55,6 +183,14 @@ void AsyncClusterData::CleanError()
     msg[0] = '\0';
 }
 
+void AsyncClusterData::AttachFollower(void *data)
+{
+    if (followers == NULL) {
+        followers = new std::vector<void *>();
+    }
+    followers->push_back(data);
+}
+
 ///////////////////////////// ASYNC CLUSTER ////////////////////////////////////
 
 AsyncCluster::AsyncCluster(const char *ip, 
@@ -64,19 +200,34 @@ AsyncCluster::AsyncCluster(const char *ip,
                            struct event_base *ev_base, 
                            AsyncClusterCallback *callback, 
                            bool debug)
-    : _ev_base(ev_base), _callback(callback), _port(port), 
-      _debug(debug), _running(false)
+    : _ev_base(ev_base), _eventAttach(NULL), _eventLoop(NULL), 
+      _callback(callback), _singleFlightHits(0), 
+      _singleFlight(false), _corkDepth(0), _priority(PRIORITY_INTERACTIVE), 
+      _lastResult(COMMAND_OK), _slab(NULL), _framePool(NULL), 
+      _useSlab(false), _replyArena(false), 
+      _currentArena(NULL), _currentReply(NULL), _respReader(false), _sharedTopology(false), 
+      _compressor(NULL), _submitQueue(NULL), _executor(NULL), 
+      _executorOrdered(false), _port(port), _debug(debug), _running(false)
 {
     memset(_ip, 0, sizeof(_ip));
 	strncpy(_ip, ip, strlen(ip));
-    _pool = new AsyncClusterPool(connect_timeout, command_timeout, 
-                                 (ConnectFn *)redisAsyncConnect, 
-                                 (FreeConnectFn *)redisAsyncFree);
+    _pool = new AsyncClusterPool(connect_timeout, command_timeout);
     _failedCommandQueue = new std::queue<AsyncClusterData *>;
+    _singleFlightMap = new SingleFlightMap();
+    _singleFlightKeys = new SingleFlightKeyMap();
+    _corkedCommands = new std::vector<AsyncClusterData *>();
+    for (int i = 0; i < PRIORITY_COUNT; i++) {
+        _flowControlMap[i] = new FlowControlMap();
+        _flowControl[i] = false;
+    }
+    _replyArenas = new ReplyArenaMap();
 }
 
 AsyncCluster::~AsyncCluster()
 {
+    delete _submitQueue;
+    _submitQueue = NULL;
+
     DisConnect();
 
     delete _callback;
@@ -84,27 +235,56 @@ AsyncCluster::~AsyncCluster()
     
     while (_failedCommandQueue->empty() == false) {
         AsyncClusterData *acData = _failedCommandQueue->front();
-        delete acData;
+        FreeCommandData(acData);
         _failedCommandQueue->pop();
     }
 
     delete _failedCommandQueue;
     _failedCommandQueue = NULL;
 
+    // the leaders are owned by the pending hiredis callbacks
+    delete _singleFlightMap;
+    _singleFlightMap = NULL;
+    delete _singleFlightKeys;
+    _singleFlightKeys = NULL;
+
+    std::vector<AsyncClusterData *>::iterator it;
+    for (it = _corkedCommands->begin(); it != _corkedCommands->end(); it++) {
+        FreeCommandData(*it);
+    }
+    delete _corkedCommands;
+    _corkedCommands = NULL;
+
+    for (int i = 0; i < PRIORITY_COUNT; i++) {
+        delete _flowControlMap[i];
+        _flowControlMap[i] = NULL;
+    }
+
+    delete _slab;
+    _slab = NULL;
+
+    delete _framePool;
+    _framePool = NULL;
+
+    ReplyArenaMap::iterator ait;
+    for (ait = _replyArenas->begin(); ait != _replyArenas->end(); ait++) {
+        delete ait->second;
+    }
+    delete _replyArenas;
+    _replyArenas = NULL;
 }
 
 bool AsyncCluster::Connect()
 {
+    if (_sharedTopology) {
+        _pool->ShareTopology(_ip, _port);
+    }
     _pool->InitPool(_ip, _port);
     
     MapPool *mapPool = _pool->GetMapPool();
     MapPool::iterator it;
     for (it = mapPool->begin(); it != mapPool->end(); it++) {
-        redisAsyncContext *context = it->second.context;
-        context->data = (void *)this;
-        redisLibeventAttach(context, _ev_base);
-        redisAsyncSetConnectCallback(context, OnConnect);
-        redisAsyncSetDisconnectCallback(context, OnDisconnect);
+        AttachNode(&(it->second));
     }
     
     _running = true;
@@ -139,12 +319,112 @@ bool AsyncCluster::PingALL(void *privdata)
 
 bool AsyncCluster::Set(const char *key, const char *val, void *privdata)
 {
-    return Command(key, privdata, "SET %s %s", key, val);
+    std::string_view value(val);
+    _lastResult = COMMAND_FAILED;
+    if (_compressor && !_compressor->Encode(key, value, value)) {
+        return false;
+    }
+    char *cmd;
+    int cmdlen = RespSet::Format(&cmd, key, value);
+    _lastResult = COMMAND_FAILED;
+    if (cmdlen < 0) {
+        return false;
+    }
+    return DispatchCommand(key, privdata, cmd, cmdlen, NULL);
 }
 
 bool AsyncCluster::Get(const char *key, void *privdata)
 {
-    return Command(key, privdata, "GET %s", key);
+    char *cmd;
+    int cmdlen = RespGet::Format(&cmd, key);
+    _lastResult = COMMAND_FAILED;
+    if (cmdlen < 0) {
+        return false;
+    }
+    return DispatchCommand(key, privdata, cmd, cmdlen, NULL, DISPATCH_DECODE);
+}
+
+bool AsyncCluster::Set(std::string_view key, std::string_view val, void *privdata)
+{
+    return DispatchSet(key, val, privdata, NULL, false);
+}
+
+bool AsyncCluster::Get(std::string_view key, void *privdata)
+{
+    char *cmd;
+    int cmdlen = RespGet::FormatArgv(&cmd, &key);
+    _lastResult = COMMAND_FAILED;
+    if (cmdlen < 0) {
+        return false;
+    }
+    return DispatchCommand(key, privdata, cmd, cmdlen, NULL, DISPATCH_DECODE);
+}
+
+bool AsyncCluster::GetValue(std::string_view key, void *privdata)
+{
+    char *cmd;
+    int cmdlen = RespGet::FormatArgv(&cmd, &key);
+    _lastResult = COMMAND_FAILED;
+    if (cmdlen < 0) {
+        return false;
+    }
+    return DispatchCommand(key, privdata, cmd, cmdlen, NULL, 
+                           DISPATCH_VALUE | DISPATCH_DECODE);
+}
+
+void AsyncCluster::Cork()
+{
+    _corkDepth++;
+}
+
+int AsyncCluster::Uncork()
+{
+    if (_corkDepth == 0 || --_corkDepth > 0) {
+        return 0;
+    }
+
+    int failed = 0;
+    std::set<redisAsyncContext *> corkedContexts;
+    
+    std::vector<AsyncClusterData *>::iterator it;
+    for (it = _corkedCommands->begin(); it != _corkedCommands->end(); it++) {
+        AsyncClusterData *acData = *it;
+        ClusterNode *node = _pool->GetNodeBySlot(acData->cmdData->index);
+        redisAsyncContext *context = node ? 
+                node->second.GetStripe(acData->cmdData->index, acData->priority) : NULL;
+        
+        if (context == NULL) {
+            acData->SetError(REDIS_ERR, "cluster node cannot found");
+            DoneCommand(NULL, acData, true);
+            failed++;
+            continue;
+        }
+
+        int res = redisAsyncFormattedCommand(context, 
+                                             OnCommand, 
+                                             acData, 
+                                             acData->cmdData->cmd, 
+                                             acData->cmdData->cmdlen);
+        if (res != REDIS_OK) {
+            acData->SetError(REDIS_ERR, "redisAsyncFormattedCommand error");
+            DoneCommand(NULL, acData, true);
+            failed++;
+            continue;
+        }
+        corkedContexts.insert(context);
+    }
+    _corkedCommands->clear();
+
+    //   Flush each node right away instead of waiting for the write event, so
+    // the whole batch of a node leaves in one write syscall.
+    std::set<redisAsyncContext *>::iterator cit;
+    for (cit = corkedContexts.begin(); cit != corkedContexts.end(); cit++) {
+        if ((*cit)->c.flags & REDIS_CONNECTED) {
+            redisAsyncHandleWrite(*cit);
+        }
+    }
+
+    return failed;
 }
 
 bool AsyncCluster::Command(std::string key, 
@@ -157,29 +437,268 @@ bool AsyncCluster::Command(std::string key,
     
     char *cmd;
     int cmdlen = redisvFormatCommand(&cmd, format, ap);
+    va_end(ap);
+    _lastResult = COMMAND_FAILED;
+    if (cmdlen < 0) {
+        return false;
+    }
+
+    return DispatchCommand(key, privdata, cmd, cmdlen, NULL);
+}
 
-    Slot index = SlotHash::slotByKey(key.c_str(), key.length());
+bool AsyncCluster::CommandArgv(std::string_view key, 
+                               void *privdata, 
+                               int argc, 
+                               const std::string_view *argv, 
+                               AsyncClusterCallback *callback)
+{
+    return DispatchArgv(key, privdata, argc, argv, callback, NULL);
+}
+
+// takes the malloc'ed command, freed even if it fails
+bool AsyncCluster::FormattedCommand(std::string_view key, 
+                                    void *privdata, 
+                                    char *cmd, 
+                                    int cmdlen)
+{
+    _lastResult = COMMAND_FAILED;
+    if (cmd == NULL) {
+        return false;
+    }
+    return DispatchCommand(key, privdata, cmd, cmdlen, NULL);
+}
+
+// formats on the calling thread, the loop dispatches it. Fails when the 
+// queue is full.
+bool AsyncCluster::Submit(std::string_view key, 
+                          void *privdata, 
+                          int argc, 
+                          const std::string_view *argv, 
+                          CommandPriority priority)
+{
+    CompletionHandler handler;
+    return PushSubmitted(key, privdata, argc, argv, handler, priority);
+}
+
+bool AsyncCluster::Get(std::string_view key, CompletionHandler handler)
+{
+    return DispatchGet(key, handler);
+}
+
+bool AsyncCluster::Set(std::string_view key, 
+                       std::string_view val, 
+                       CompletionHandler handler)
+{
+    return DispatchSet(key, val, NULL, &handler, false);
+}
+
+// leaves 'handler' to the caller if it fails
+bool AsyncCluster::DispatchGet(std::string_view key, CompletionHandler &handler)
+{
+    char *cmd;
+    int cmdlen = RespGet::FormatArgv(&cmd, &key);
+    _lastResult = COMMAND_FAILED;
+    if (cmdlen < 0) {
+        return false;
+    }
+    return DispatchCommand(key, NULL, cmd, cmdlen, NULL, DISPATCH_DECODE, NULL, 
+                           &handler);
+}
+
+bool AsyncCluster::CommandArgv(std::string_view key, 
+                               int argc, 
+                               const std::string_view *argv, 
+                               CompletionHandler handler)
+{
+    return DispatchArgv(key, NULL, argc, argv, NULL, &handler);
+}
+
+bool AsyncCluster::FormattedCommand(std::string_view key, 
+                                    CompletionHandler &handler, 
+                                    char *cmd, 
+                                    int cmdlen)
+{
+    _lastResult = COMMAND_FAILED;
+    if (cmd == NULL) {
+        return false;
+    }
+    return DispatchCommand(key, NULL, cmd, cmdlen, NULL, 0, NULL, &handler);
+}
+
+bool AsyncCluster::Submit(std::string_view key, 
+                          int argc, 
+                          const std::string_view *argv, 
+                          CompletionHandler handler, 
+                          CommandPriority priority)
+{
+    return PushSubmitted(key, NULL, argc, argv, handler, priority);
+}
+
+std::future<CommandResult> AsyncCluster::GetFuture(std::string_view key)
+{
+    std::promise<CommandResult> promise;
+    std::future<CommandResult> future = promise.get_future();
+    // a command that is not sent completes with an empty result
+    CompletionHandler handler = PromiseHandler(std::move(promise));
+    if (DispatchGet(key, handler) == false) {
+        handler(NULL);
+    }
+    return future;
+}
+
+std::future<CommandResult> AsyncCluster::SubmitFuture(std::string_view key, 
+                                                      int argc, 
+                                                      const std::string_view *argv, 
+                                                      CommandPriority priority)
+{
+    std::promise<CommandResult> promise;
+    std::future<CommandResult> future = promise.get_future();
+    CompletionHandler handler = PromiseHandler(std::move(promise));
+    if (PushSubmitted(key, NULL, argc, argv, handler, priority) == false) {
+        handler(NULL);
+    }
+    return future;
+}
+
+void AsyncCluster::EnableSubmitQueue(size_t capacity, size_t batch)
+{
+    if (_submitQueue == NULL && _ev_base) {
+        _submitQueue = new SubmitQueue(this, capacity, batch);
+    }
+}
+
+bool AsyncCluster::DispatchCommand(std::string_view key, 
+                                   void *privdata, 
+                                   char *cmd, 
+                                   int cmdlen, 
+                                   ArgvCommand *argv, 
+                                   int flags, 
+                                   AsyncClusterCallback *callback, 
+                                   CompletionHandler *handler)
+{
+    //   A write makes the reads of its key already on the wire stale, later 
+    // reads must not follow them. Argv commands are not parsed and count as 
+    // writes.
+    bool tracked = _singleFlight || _singleFlightKeys->empty() == false;
+    bool read = tracked && cmd && IsReadOnlyCommand(cmd, cmdlen);
+    if (tracked && !read) {
+        EvictSingleFlight(key);
+    }
+
+    // identical read is already on the wire, wait for its reply instead
+    //   GetValue() callers and commands with their own callback complete 
+    // differently and never share a reply. Neither do reads of another 
+    // priority, they go through their own lane.
+    bool flight = !(flags & DISPATCH_VALUE) && callback == NULL && handler == NULL && 
+                  _singleFlight && read;
+    std::string flightKey;
+    if (flight) {
+        flightKey = SingleFlightKey(cmd, cmdlen, _priority);
+        SingleFlightMap::iterator it = _singleFlightMap->find(flightKey);
+        if (it != _singleFlightMap->end()) {
+            it->second->AttachFollower(privdata);
+            _singleFlightHits++;
+            _lastResult = COMMAND_OK;
+            free(cmd);
+            return true;
+        }
+    }
+
+    // another client refreshed the shared topology, pending commands of
+    // the old connections are retried on the new ones
+    if (_pool->IsStale()) {
+        UpdatePool();
+    }
+
+    Slot index = SlotHash::slotByKey(key.data(), key.length());
     ClusterNode *node = _pool->GetNodeBySlot(index);
-    if (node == NULL) {
+    redisAsyncContext *context = node ? node->second.GetStripe(index, _priority) : NULL;
+    if (context == NULL) {
         free(cmd);
+        delete argv;
         return false;
     }
 
-    redisAsyncContext *context = node->second.context;
+    NodeFlowControl *flow = NULL;
+    if (_flowControl[_priority]) {
+        FlowControlMap *flowControlMap = _flowControlMap[_priority];
+        FlowControlMap::iterator fit = flowControlMap->find(node->second.id);
+        if (fit == flowControlMap->end()) {
+            fit = flowControlMap->insert(FlowControlMap::value_type(
+                    node->second.id, NodeFlowControl(&_flowOptions[_priority]))).first;
+        }
+        flow = &(fit->second);
+        if (!flow->Acquire(cmdlen)) {
+            free(cmd);
+            delete argv;
+            _lastResult = COMMAND_QUEUEFULL;
+            return false;
+        }
+    }
+
     context->data = (void *)this;
-    CommandData *cmdData = new CommandData(cmd, key, index, cmdlen);
-    AsyncClusterData *acData = new AsyncClusterData(cmdData, privdata);
+    AsyncClusterData *acData = NewCommandData(cmd, index, cmdlen, privdata);
+    acData->cmdData->argv = argv;
+    acData->value = (flags & DISPATCH_VALUE) != 0;
+    acData->decode = (flags & DISPATCH_DECODE) != 0;
+    acData->callback = callback;
+    acData->priority = _priority;
+    if (handler) {
+        acData->handler = std::move(*handler);
+    }
+    if (flow) {
+        acData->flow = flow;
+        acData->sendUsec = GetCurrUsec();
+    }
 
-    int res = redisAsyncFormattedCommand(context, 
-                                         OnCommand, 
-                                         acData, 
-                                         acData->cmdData->cmd, 
-                                         acData->cmdData->cmdlen);
-    if (res != REDIS_OK) {
-        delete acData;
-        return false;
+    // zero-copy needs the bytes to be written right now, in order
+    if (argv && (_corkDepth > 0 || !(context->c.flags & REDIS_CONNECTED))) {
+        acData->cmdData->Flatten();
+    }
+
+    // only buffered while corked, sent to its node on Uncork()
+    if (_corkDepth > 0) {
+        _corkedCommands->push_back(acData);
+    } else {
+        int res = REDIS_ERR;
+        if (acData->cmdData->cmd) {
+            res = redisAsyncFormattedCommand(context, 
+                                             OnCommand, 
+                                             acData, 
+                                             acData->cmdData->cmd, 
+                                             acData->cmdData->cmdlen);
+        } else if (SendArgvCommand(context, acData)) {
+            res = REDIS_OK;
+        }
+        if (res != REDIS_OK) {
+            if (acData->flow) {
+                acData->flow->Cancel(cmdlen);
+            }
+            // the caller keeps the handler of a command never sent
+            if (handler) {
+                *handler = std::move(acData->handler);
+            }
+            FreeCommandData(acData);
+            return false;
+        }
+    }
+
+    // the key is indexed from the command, a routing key that is not one of
+    // its arguments cannot be evicted by a write and is not shared
+    CommandData *cmdData = acData->cmdData;
+    if (flight) {
+        cmdData->key = CommandData::FindKey(cmdData->cmd, cmdData->cmdlen, 
+                                            key.data(), key.length());
+    }
+    if (cmdData->key) {
+        cmdData->keylen = key.length();
+        acData->inflight = true;
+        _singleFlightMap->insert(SingleFlightMap::value_type(flightKey, acData));
+        _singleFlightKeys->insert(SingleFlightKeyMap::value_type(
+                std::string_view(cmdData->key, cmdData->keylen), acData));
     }
     
+    _lastResult = COMMAND_OK;
     return true;
 }
 
@@ -190,14 +709,60 @@ bool AsyncCluster::DoneCommand(redisReply *reply, void *acdata, bool if_free)
         return false;
     }
 
+    if (acData->inflight) {
+        FinishSingleFlight(acData);
+    }
+
     if (reply == NULL || acData->err) {
-        _callback->OnCommand(NULL, (void *)this, acData->privdata);
+        reply = NULL;
+    }
+    if (acData->flow) {
+        ReleaseFlow(acData, reply == NULL);
+    }
+    // the callbacks only see decoded values, undecodable ones are left as is
+    redisReply decoded;
+    if (acData->decode && _compressor && reply && reply->type == REDIS_REPLY_STRING) {
+        std::string_view value(reply->str, reply->len);
+        if (_compressor->Decode(value, value) && value.data() != reply->str) {
+            decoded = *reply;
+            decoded.str = (char *)value.data();
+            decoded.len = value.size();
+            reply = &decoded;
+        }
+    }
+
+    AsyncClusterCallback *callback = acData->callback ? acData->callback : _callback;
+    if (_executor) {
+        PostCallback(callback, reply, acData);
+        if (if_free) {
+            FreeCommandData(acData);
+        }
+        return true;
+    }
+
+    if (acData->handler.is_retaining()) {
+        acData->handler.Take(reply ? RetainReply(reply) : NULL);
+    } else if (acData->handler) {
+        acData->handler(reply);
+    } else if (acData->value && reply && (reply->type == REDIS_REPLY_STRING || 
+                                          reply->type == REDIS_REPLY_NIL)) {
+        callback->OnValue(std::string_view(reply->str ? reply->str : "", reply->len), 
+                          reply->type == REDIS_REPLY_STRING, 
+                          (void *)this, acData->privdata);
     } else {
-        _callback->OnCommand(reply, (void *)this, acData->privdata);
+        callback->OnCommand(reply, (void *)this, acData->privdata);
+    }
+
+    // every follower receives the very same reply object
+    if (acData->followers) {
+        std::vector<void *>::iterator it;
+        for (it = acData->followers->begin(); it != acData->followers->end(); it++) {
+            callback->OnCommand(reply, (void *)this, *it);
+        }
     }
 
     if (if_free) {
-        delete acData;
+        FreeCommandData(acData);
     }
     return true;
 }
@@ -209,13 +774,19 @@ bool AsyncCluster::RetryCommand(redisAsyncContext *retryContext, void *acdata)
         return false;
     }
 
-    if (retryContext->c.flags & (REDIS_DISCONNECTING | REDIS_FREEING)) {
+    if (retryContext == NULL || 
+            retryContext->c.flags & (REDIS_DISCONNECTING | REDIS_FREEING)) {
         acData->SetError(REDIS_ERR, "Don't accept new commands when the "
                                     "connection is about to be closed.");
         DoneCommand(NULL, acdata, true);
         return false;
     }
 
+    // the zero-copy arguments are copied once a command has to be resent
+    if (acData->cmdData->Flatten() == false) {
+        return false;
+    }
+
     int res = redisAsyncFormattedCommand(retryContext, 
                                          OnCommand,
                                          acData,
@@ -247,7 +818,7 @@ int AsyncCluster::RetryFailedCommands()
         }
         
         acData->CleanError();
-        retryContext = node->second.context;
+        retryContext = node->second.GetStripe(acData->cmdData->index, acData->priority);
         bool res = RetryCommand(retryContext, acData);
         if (!res) {
             failurePendingCommandCount++;
@@ -302,6 +873,200 @@ ReplyType AsyncCluster::ProcessReply(redisReply *reply)
     return OK;
 }
 
+bool AsyncCluster::IsReadOnlyCommand(const char *cmd, int cmdlen)
+{
+    static const char *readOnlyCommands[] = {
+        "GET", "MGET", "GETRANGE", "STRLEN", "EXISTS", "TYPE", "TTL", "PTTL",
+        "HGET", "HMGET", "HGETALL", "HKEYS", "HVALS", "HLEN", "HEXISTS",
+        "LRANGE", "LLEN", "LINDEX", "SMEMBERS", "SISMEMBER", "SCARD",
+        "ZRANGE", "ZRANGEBYSCORE", "ZSCORE", "ZRANK", "ZCARD", "ZCOUNT", NULL
+    };
+
+    // formatted command looks like "*<argc>\r\n$<len>\r\n<name>\r\n..."
+    const char *p = (const char *)memchr(cmd, '$', cmdlen);
+    if (p == NULL) {
+        return false;
+    }
+    int len = atoi(p + 1);
+    p = (const char *)memchr(p, '\n', cmdlen - (p - cmd));
+    if (p == NULL || len <= 0 || (p + 1 + len) > (cmd + cmdlen)) {
+        return false;
+    }
+    p++;
+
+    for (int i = 0; readOnlyCommands[i] != NULL; i++) {
+        if ((int)strlen(readOnlyCommands[i]) == len && 
+                strncasecmp(p, readOnlyCommands[i], len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AsyncCluster::SetFlowControl(const FlowControlOptions &opts, 
+                                  CommandPriority priority)
+{
+    _flowOptions[priority] = opts;
+    _flowControl[priority] = opts.maxInflight > 0 || opts.maxInflightBytes > 0 || 
+                             opts.adaptive;
+
+    // restart every node from the new limits
+    FlowControlMap::iterator it;
+    FlowControlMap *flowControlMap = _flowControlMap[priority];
+    for (it = flowControlMap->begin(); it != flowControlMap->end(); it++) {
+        NodeFlowControl &flow = it->second;
+        flow.limit = opts.adaptive ? opts.minInflight : opts.maxInflight;
+        flow.increaseCount = 0;
+    }
+}
+
+bool AsyncCluster::IsQueueFull(const std::string &key, uint32_t bytes)
+{
+    if (!_flowControl[_priority]) {
+        return false;
+    }
+
+    ClusterNode *node = _pool->GetNodeByKey(&key);
+    if (node == NULL) {
+        return false;
+    }
+
+    FlowControlMap *flowControlMap = _flowControlMap[_priority];
+    FlowControlMap::iterator it = flowControlMap->find(node->second.id);
+    if (it == flowControlMap->end()) {
+        return false;
+    }
+    // a caller held back here is told by OnLaneReady() like a rejected one
+    if (it->second.IsFull(bytes)) {
+        it->second.waiting = true;
+        return true;
+    }
+    return false;
+}
+
+void AsyncCluster::PrintFlowControl()
+{
+    FlowControlMap::iterator it;
+
+    for (int i = 0; i < PRIORITY_COUNT; i++) {
+        FlowControlMap *flowControlMap = _flowControlMap[i];
+        std::cout << "\n[flow control | priority " << i 
+                  << " | at " << flowControlMap << "]" << std::endl;
+        for (it = flowControlMap->begin(); it != flowControlMap->end(); it++) {
+            NodeFlowControl &flow = it->second;
+            std::cout << "\t[ID | " << it->first << " | "
+                      << "inflight | " << flow.inflight << " | "
+                      << "bytes | " << flow.inflightBytes << " | "
+                      << "limit | " << flow.limit << " | "
+                      << "completed | " << flow.completed << " | "
+                      << "rejected | " << flow.rejected
+                      << "]\n";
+        }
+    }
+    std::cout << std::endl;
+}
+
+RetainedReply *AsyncCluster::RetainReply(redisReply *reply)
+{
+    //   Only the root of the reply being dispatched owns the arena, anything 
+    // else (a reply from the hiredis allocator, one already retained, an
+    // element, a decoded value on the stack) is deep-copied.
+    RetainedReply *retained = NULL;
+    if (_currentArena && reply == _currentReply) {
+        retained = _currentArena->Retain(reply);
+    }
+    if (retained == NULL) {
+        retained = ReplyArena::Copy(reply);
+    }
+    return retained;
+}
+
+// the reply outlives the loop callback through RetainReply(), which copies
+// a decoded value
+void AsyncCluster::PostCallback(AsyncClusterCallback *callback, 
+                                redisReply *reply, 
+                                AsyncClusterData *acData)
+{
+    ExecutorCallback *task = new ExecutorCallback();
+    task->asyncCluster = this;
+    task->callback = callback;
+    task->reply = NULL;
+    if (reply) {
+        task->reply = RetainReply(reply);
+    }
+    task->privdata = acData->privdata;
+    if (acData->followers) {
+        task->followers = *acData->followers;
+    }
+    task->value = acData->value;
+    task->handler = std::move(acData->handler);
+
+    if (_executorOrdered && acData->cmdData) {
+        _executor->PostOrdered(acData->cmdData->index, RunCallback, task);
+    } else {
+        _executor->Post(RunCallback, task);
+    }
+}
+
+// runs on a worker, the reply lives until the callbacks return
+void AsyncCluster::RunCallback(void *arg)
+{
+    ExecutorCallback *task = (ExecutorCallback *)arg;
+    redisReply *reply = task->reply ? task->reply->GetReply() : NULL;
+    AsyncClusterCallback *callback = task->callback;
+    void *self = (void *)task->asyncCluster;
+
+    if (task->handler) {
+        task->handler.Take(task->reply);
+        task->reply = NULL;
+    } else if (task->value && reply && (reply->type == REDIS_REPLY_STRING || 
+                                        reply->type == REDIS_REPLY_NIL)) {
+        callback->OnValue(std::string_view(reply->str ? reply->str : "", reply->len), 
+                          reply->type == REDIS_REPLY_STRING, self, task->privdata);
+    } else {
+        callback->OnCommand(reply, self, task->privdata);
+    }
+    for (size_t i = 0; i < task->followers.size(); i++) {
+        callback->OnCommand(reply, self, task->followers[i]);
+    }
+
+    delete task->reply;
+    delete task;
+}
+
+FramePool *AsyncCluster::GetFramePool()
+{
+    if (_framePool == NULL) {
+        _framePool = new FramePool();
+    }
+    return _framePool;
+}
+
+void AsyncCluster::SetConnectionsPerNode(uint32_t count)
+{
+    _pool->SetStripes(count);
+}
+
+uint32_t AsyncCluster::GetConnectionsPerNode()
+{
+    return _pool->GetStripes();
+}
+
+void AsyncCluster::SetPriorityLanes(bool enable)
+{
+    _pool->SetLanes(enable ? PRIORITY_COUNT : 1);
+}
+
+void AsyncCluster::SetSlabAllocation(bool enable)
+{
+    // the slab lives as long as the cluster, commands allocated from it may
+    // still be pending after it has been disabled
+    if (enable && _slab == NULL) {
+        _slab = new SlabAllocator(sizeof(AsyncClusterData) + sizeof(CommandData));
+    }
+    _useSlab = enable;
+}
+
 UpdatePoolType AsyncCluster::UpdatePool()
 {
     UpdatePoolType res = _pool->UpdatePool();
@@ -313,16 +1078,273 @@ UpdatePoolType AsyncCluster::UpdatePool()
     MapPool *mapPool = _pool->GetMapPool();
     MapPool::iterator it;
     for (it = mapPool->begin(); it != mapPool->end(); it++) {
-        redisAsyncContext *newcontext = it->second.context;
-        newcontext->data = (void *)this;
-        redisLibeventAttach(newcontext, _ev_base);
-        redisAsyncSetConnectCallback(newcontext, OnConnect);
-        redisAsyncSetDisconnectCallback(newcontext, OnDisconnect);
+        AttachNode(&(it->second));
     }
 
     return UPDATE_TRUE;
 }
 
+/////////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////
+
+void AsyncCluster::FinishSingleFlight(AsyncClusterData *acData)
+{
+    // later identical reads must hit the server again
+    CommandData *cmdData = acData->cmdData;
+    _singleFlightMap->erase(SingleFlightKey(cmdData->cmd, cmdData->cmdlen, 
+                                            acData->priority));
+    std::pair<SingleFlightKeyMap::iterator, SingleFlightKeyMap::iterator> range = 
+            _singleFlightKeys->equal_range(std::string_view(cmdData->key, cmdData->keylen));
+    for (SingleFlightKeyMap::iterator it = range.first; it != range.second; it++) {
+        if (it->second == acData) {
+            _singleFlightKeys->erase(it);
+            break;
+        }
+    }
+    acData->inflight = false;
+}
+
+void AsyncCluster::EvictSingleFlight(std::string_view key)
+{
+    // the evicted reads still complete, only without new followers
+    std::pair<SingleFlightKeyMap::iterator, SingleFlightKeyMap::iterator> range = 
+            _singleFlightKeys->equal_range(key);
+    for (SingleFlightKeyMap::iterator it = range.first; it != range.second; it++) {
+        AsyncClusterData *acData = it->second;
+        _singleFlightMap->erase(SingleFlightKey(acData->cmdData->cmd, 
+                                                acData->cmdData->cmdlen, 
+                                                acData->priority));
+        acData->inflight = false;
+    }
+    _singleFlightKeys->erase(range.first, range.second);
+}
+
+std::string AsyncCluster::SingleFlightKey(const char *cmd, 
+                                          int cmdlen, 
+                                          CommandPriority priority)
+{
+    std::string flightKey(1, (char)priority);
+    flightKey.append(cmd, cmdlen);
+    return flightKey;
+}
+
+bool AsyncCluster::DispatchArgv(std::string_view key, 
+                                void *privdata, 
+                                int argc, 
+                                const std::string_view *argv, 
+                                AsyncClusterCallback *callback, 
+                                CompletionHandler *handler, 
+                                bool copy)
+{
+    _lastResult = COMMAND_FAILED;
+    ArgvCommand *argvCmd = new ArgvCommand(argc, argv);
+
+    // small arguments have all been copied, same as a formatted command
+    if (copy || argvCmd->IsZeroCopy() == false) {
+        char *cmd = argvCmd->Format();
+        int cmdlen = argvCmd->GetLength();
+        delete argvCmd;
+        if (cmd == NULL) {
+            return false;
+        }
+        return DispatchCommand(key, privdata, cmd, cmdlen, NULL, 0, callback, handler);
+    }
+
+    return DispatchCommand(key, privdata, NULL, argvCmd->GetLength(), argvCmd, 
+                           0, callback, handler);
+}
+
+// 'copy' when 'val' does not outlive the call. An encoded value never does,
+// it lives in the compressor until the next Encode().
+bool AsyncCluster::DispatchSet(std::string_view key, 
+                               std::string_view val, 
+                               void *privdata, 
+                               CompletionHandler *handler, 
+                               bool copy)
+{
+    _lastResult = COMMAND_FAILED;
+    std::string_view encoded = val;
+    if (_compressor && !_compressor->Encode(key, val, encoded)) {
+        return false;
+    }
+    std::string_view argv[3] = { "SET", key, encoded };
+    return DispatchArgv(key, privdata, 3, argv, NULL, handler, 
+                        copy || encoded.data() != val.data());
+}
+
+bool AsyncCluster::PushSubmitted(std::string_view key, 
+                                 void *privdata, 
+                                 int argc, 
+                                 const std::string_view *argv, 
+                                 CompletionHandler &handler, 
+                                 CommandPriority priority)
+{
+    if (_submitQueue == NULL) {
+        return false;
+    }
+    ArgvCommand argvCmd(argc, argv);
+    SubmittedCommand command;
+    command.cmd = argvCmd.Format();
+    if (command.cmd == NULL) {
+        return false;
+    }
+    command.cmdlen = argvCmd.GetLength();
+    command.key.assign(key.data(), key.length());
+    command.privdata = privdata;
+    command.handler = std::move(handler);
+    command.priority = priority;
+
+    if (_submitQueue->Push(command) == false) {
+        free(command.cmd);
+        handler = std::move(command.handler);
+        return false;
+    }
+    return true;
+}
+
+// takes over the reply retained on the loop thread, so it may run anywhere
+CompletionHandler AsyncCluster::PromiseHandler(std::promise<CommandResult> &&promise)
+{
+    return CompletionHandler(
+            [promise = std::move(promise)](RetainedReply *reply) mutable {
+        promise.set_value(CommandResult(reply));
+    });
+}
+
+bool AsyncCluster::SendArgvCommand(redisAsyncContext *context, 
+                                   AsyncClusterData *acData)
+{
+    ArgvCommand *argv = acData->cmdData->argv;
+    const struct iovec *iov = argv->GetIov();
+    int iovcnt = argv->GetIovCount();
+
+    //   The first segment (header, command name, small arguments) always is 
+    // copied, hiredis needs it to register the callback. It is written out 
+    // with everything queued before it, then the large arguments go with
+    // writev() from the caller's memory. What the socket does not accept is 
+    // copied into the output buffer.
+    int res = redisAsyncFormattedCommand(context, 
+                                         OnCommand, 
+                                         acData, 
+                                         (const char *)iov[0].iov_base, 
+                                         iov[0].iov_len);
+    if (res != REDIS_OK) {
+        return false;
+    }
+
+    size_t offset = iov[0].iov_len;
+    int done = 0;
+    if (redisBufferWrite(&context->c, &done) == REDIS_OK && done) {
+        ssize_t nwritten;
+        while (offset < argv->GetLength() && 
+               (nwritten = argv->Write(context->c.fd, offset)) > 0) {
+            offset += nwritten;
+        }
+    }
+
+    for (int i = 0; i < iovcnt; i++) {
+        if (offset >= iov[i].iov_len) {
+            offset -= iov[i].iov_len;
+            continue;
+        }
+        redisAppendFormattedCommand(&context->c, 
+                                    (const char *)iov[i].iov_base + offset, 
+                                    iov[i].iov_len - offset);
+        offset = 0;
+    }
+    return true;
+}
+
+// connections the pool update kept are attached already
+void AsyncCluster::AttachNode(ClusterNodeData *nodeData)
+{
+    if (nodeData->context->data == NULL) {
+        AttachContext(nodeData->context);
+    }
+    for (size_t i = 0; i < nodeData->stripes.size(); i++) {
+        if (nodeData->stripes[i]->data == NULL) {
+            AttachContext(nodeData->stripes[i]);
+        }
+    }
+}
+
+void AsyncCluster::AttachContext(redisAsyncContext *context)
+{
+    context->data = (void *)this;
+    if (_eventAttach) {
+        _eventAttach(context, _eventLoop);
+    } else if (_respReader) {
+        RespReader::LibeventAttach(context, _ev_base);
+    } else {
+        redisLibeventAttach(context, _ev_base);
+    }
+    redisAsyncSetConnectCallback(context, OnConnect);
+    redisAsyncSetDisconnectCallback(context, OnDisconnect);
+
+    if (_replyArena) {
+        ReplyArena *arena = new ReplyArena();
+        arena->Attach(&context->c);
+        (*_replyArenas)[context] = arena;
+    }
+}
+
+auto AsyncCluster::NewCommandData(char *cmd, 
+                                  Slot index, 
+                                  uint32_t cmdlen, 
+                                  void *privdata) -> AsyncClusterData *
+{
+    if (_useSlab == false) {
+        CommandData *cmdData = new CommandData(cmd, index, cmdlen);
+        return new AsyncClusterData(cmdData, privdata);
+    }
+
+    // both objects share one slab entry
+    char *mem = (char *)_slab->Allocate();
+
+    CommandData *cmdData = new (mem + sizeof(AsyncClusterData)) 
+            CommandData(cmd, index, cmdlen);
+    AsyncClusterData *acData = new (mem) AsyncClusterData(cmdData, privdata);
+    acData->pooled = true;
+    return acData;
+}
+
+void AsyncCluster::FreeCommandData(AsyncClusterData *acData)
+{
+    if (acData->pooled == false) {
+        delete acData;
+        return;
+    }
+
+    CommandData *cmdData = acData->cmdData;
+    acData->cmdData = NULL;
+    acData->~AsyncClusterData();
+    if (cmdData) {
+        cmdData->~CommandData();
+    }
+    _slab->Free(acData);
+}
+
+void AsyncCluster::ReleaseFlow(AsyncClusterData *acData, bool failed)
+{
+    int64_t now = GetCurrUsec();
+    NodeFlowControl *flow = acData->flow;
+    acData->flow = NULL;
+
+    bool ready = flow->Release(acData->cmdData->cmdlen, 
+                               now - acData->sendUsec, failed, now);
+    if (ready == false || _callback == NULL) {
+        return;
+    }
+
+    FlowControlMap::iterator it;
+    FlowControlMap *flowControlMap = _flowControlMap[acData->priority];
+    for (it = flowControlMap->begin(); it != flowControlMap->end(); it++) {
+        if (&(it->second) == flow) {
+            _callback->OnLaneReady(it->first.c_str(), acData->priority);
+            break;
+        }
+    }
+}
+
 //////////////////////////// CALLBACK FUNCTIONS ////////////////////////////////
 
 void AsyncCluster::OnCommand(redisAsyncContext *context, void *r, void *acdata)
@@ -334,12 +1356,17 @@ void AsyncCluster::OnCommand(redisAsyncContext *context, void *r, void *acdata)
     AsyncCluster *asyncCluster = (AsyncCluster *)context->data;
     redisReply *reply = (redisReply *)r;
     AsyncClusterData *acData = (AsyncClusterData *)acdata;
+
+    // the reply lives until this callback returns, unless it is retained
+    ReplyArena *arena = reply ? ReplyArena::GetArena(&context->c) : NULL;
+    ReplyArenaScope arenaScope(arena, &asyncCluster->_currentArena);
+    asyncCluster->_currentReply = reply;
     AsyncClusterPool *pool = NULL;
     ClusterNode *node = NULL;
     ClusterNodeData *nodeData = NULL;
 
     if (acData->cmdData == NULL) {
-        delete acData;
+        asyncCluster->FreeCommandData(acData);
         return;
     }
     
@@ -370,8 +1397,10 @@ void AsyncCluster::OnCommand(redisAsyncContext *context, void *r, void *acdata)
         // this function handles all the pending callbacks first, then will do 
         // actual freeing. Once the old callback with the old context is reached
         // , it needs to be resended to the new one.
-        if (node->second.context != context) {
-            asyncCluster->RetryCommand(node->second.context, acData);
+        redisAsyncContext *stripe = 
+                node->second.GetStripe(acData->cmdData->index, acData->priority);
+        if (stripe != context) {
+            asyncCluster->RetryCommand(stripe, acData);
             return;
         }
         
@@ -483,6 +1512,13 @@ void AsyncCluster::OnDisconnect(const redisAsyncContext *context, int status)
     }
 
     AsyncCluster *asyncCluster = (AsyncCluster *)context->data;    
+    ReplyArenaMap::iterator ait = asyncCluster->_replyArenas->find(context);
+    if (ait != asyncCluster->_replyArenas->end()) {
+        // the reader is freed right after, it never calls into the arena again
+        delete ait->second;
+        asyncCluster->_replyArenas->erase(ait);
+    }
+
     ClusterNode *node = asyncCluster->GetPool()->GetNodeByCtx(context);
     if (node == NULL) {
         return;
@@ -490,7 +1526,14 @@ void AsyncCluster::OnDisconnect(const redisAsyncContext *context, int status)
     
     ClusterNodeData *nodeData = &(node->second);
     nodeData->connected = false;
-    nodeData->context = NULL;
+    if (nodeData->context == context) {
+        nodeData->context = NULL;
+    }
+    for (size_t i = 0; i < nodeData->stripes.size(); i++) {
+        if (nodeData->stripes[i] == context) {
+            nodeData->stripes[i] = NULL;
+        }
+    }
 
     if (asyncCluster->is_running()) {
         // handle unexpected disconnection here
@@ -506,8 +1549,6 @@ void AsyncCluster::OnDisconnect(const redisAsyncContext *context, int status)
     }    
 }
 
-// not used for now
-#if false
 int64_t GetCurrUsec()
 {
     int64_t usec;
@@ -522,6 +1563,5 @@ int64_t GetCurrUsec()
     usec = (int64_t)now.tv_sec * 1000000LL + (int64_t)now.tv_usec;
     return usec;
 }
-#endif
 
 } // RedisClusterAPI
\ No newline at end of file
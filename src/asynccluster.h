@@ -8,14 +8,29 @@
 
 #include <string.h>
 #include <string>
+#include <string_view>
 #include <map>
 #include <queue>
+#include <vector>
+#include <unordered_map>
+#include <set>
+#include <new>
 #include <stdarg.h>
+#include <future>
 
 #include "slothash.h"
 #include "clustertypelist.h"
 #include "clusterpool.h"
 #include "cluster.h"
+#include "slaballocator.h"
+#include "argvcommand.h"
+#include "respcommand.h"
+#include "replyarena.h"
+#include "respreader.h"
+#include "valuecodec.h"
+#include "submitqueue.h"
+#include "callbackexecutor.h"
+#include "completionhandler.h"
 
 namespace RedisClusterAPI
 {
@@ -26,6 +41,8 @@ class ClusterPool;
 template<typename CONTEXT>
 class ClusterTypeList;
 
+class AsyncClusterCallback;
+
 enum ReplyType;
 enum UpdatePoolType;
 
@@ -33,18 +50,66 @@ class CommandData
 {
 public:
     CommandData();
-    CommandData(char *c, std::string k, uint32_t idx, uint32_t len);
+    CommandData(char *c, uint32_t idx, uint32_t len);
     ~CommandData();
+    bool Flatten();
+    static const char *FindKey(const char *cmd, uint32_t cmdlen, 
+                               const char *key, uint32_t keylen);
 public:
     char *cmd;
-    std::string key;
+    const char *key;     // points into 'cmd', only set for single-flight reads
+    uint32_t keylen;
     uint32_t index;
     uint32_t cmdlen;
     uint32_t retryCount; // TODO: not used for now
+    ArgvCommand *argv;   // zero-copy arguments, 'cmd' is built on retry
 public:
     static const uint32_t RETRYMAXCOUNT = 5;
 };
 
+// Per-node bound of the outstanding commands.
+//   With 'adaptive' set, the in-flight limit follows AIMD: it grows by one per
+// window of completions under 'latencyTarget' usec and halves (at most once 
+// per 'latencyTarget') on a slower or failed completion, within 
+// [minInflight, maxInflight].
+struct FlowControlOptions
+{
+    FlowControlOptions() 
+        : maxInflight(0), maxInflightBytes(0), adaptive(false), 
+          minInflight(1), latencyTarget(0) {}
+    uint32_t maxInflight;      // 0 for unlimited
+    uint64_t maxInflightBytes; // 0 for unlimited
+    bool adaptive;
+    uint32_t minInflight;
+    int64_t latencyTarget;
+};
+
+class NodeFlowControl
+{
+public:
+    NodeFlowControl();
+    NodeFlowControl(const FlowControlOptions *opts);
+    bool Acquire(uint32_t bytes);
+    bool Release(uint32_t bytes, int64_t latency, bool failed, int64_t now);
+    void Cancel(uint32_t bytes);
+    bool IsFull(uint32_t bytes);
+public:
+    const FlowControlOptions *options;
+    uint32_t inflight;
+    uint64_t inflightBytes;
+    uint32_t limit;            // current in-flight limit
+    uint32_t increaseCount;    // completions since the last increase
+    int64_t lastDecrease;
+    uint64_t completed;
+    uint64_t rejected;
+    bool waiting;              // a caller has been rejected
+};
+
+enum DispatchFlag {
+    DISPATCH_VALUE = 0x1,   // completes through OnValue()
+    DISPATCH_DECODE = 0x2   // decoded by the compressor, if any
+};
+
 class AsyncClusterData
 {
 public:
@@ -53,19 +118,51 @@ public:
     ~AsyncClusterData();
     void SetError(int type, const char *str);
     void CleanError();
+    void AttachFollower(void *data);
 public:
     CommandData *cmdData;
     void *privdata;
     int err;
     char msg[128];
+    bool inflight;                  // registered in the single-flight table
+    std::vector<void *> *followers; // privdata of the deduplicated callers
+    NodeFlowControl *flow;          // node charged for this command
+    int64_t sendUsec;
+    bool pooled;                    // allocated from the slab of the cluster
+    bool value;                     // completes through OnValue()
+    bool decode;                    // the reply goes through the compressor
+    AsyncClusterCallback *callback; // replaces the cluster callback if set
+    CommandPriority priority;
+    CompletionHandler handler;      // replaces both callbacks if set
 };
 
 class AsyncClusterCallback : public ClusterTypeList<redisAsyncContext>
 {
 public:
+    virtual ~AsyncClusterCallback() {}
     virtual void OnConnect(const redisAsyncContext *context, int status) = 0;
     virtual void OnDisconnect(const redisAsyncContext *context, int status) = 0;
     virtual void OnCommand(redisReply *reply, void *self, void *privdata) = 0;
+    // the node 'id' accepts commands again after COMMAND_QUEUEFULL
+    virtual void OnReady(const char * /* id */) {}
+    // same for the lane 'priority' of the node, defaults to OnReady()
+    virtual void OnLaneReady(const char *id, CommandPriority /* priority */) { OnReady(id); }
+    // result of GetValue(), 'value' is only valid during the call and 'found'
+    // is false for a nil reply. Failures still go through OnCommand()
+    virtual void OnValue(std::string_view /* value */, bool /* found */, 
+                         void * /* self */, void * /* privdata */) {}
+};
+
+// completion handed to the CallbackExecutor, owns the retained reply
+struct ExecutorCallback
+{
+    AsyncCluster *asyncCluster;
+    AsyncClusterCallback *callback;
+    RetainedReply *reply;
+    void *privdata;
+    std::vector<void *> followers;
+    bool value;
+    CompletionHandler handler;
 };
 
 // TODO: set a timer to constant RetryFailedCommands()
@@ -74,6 +171,11 @@ class AsyncCluster : public ClusterTypeList<redisAsyncContext>
 {
 public:
     typedef ClusterPool<redisAsyncContext> AsyncClusterPool;
+    typedef std::unordered_map<std::string, AsyncClusterData *> SingleFlightMap;
+    typedef std::unordered_multimap<std::string_view, AsyncClusterData *> SingleFlightKeyMap;
+    typedef std::unordered_map<std::string, NodeFlowControl>    FlowControlMap;
+    typedef std::unordered_map<const redisAsyncContext *, ReplyArena *> ReplyArenaMap;
+    typedef int (EventAttachFn)(redisAsyncContext *context, void *loop);
 public:
     AsyncCluster(const char *ip, 
                  int port, 
@@ -91,8 +193,44 @@ public:
     bool PingALL(void *privdata = NULL);
     bool Set(const char *key, const char *val, void *privdata = NULL);
     bool Get(const char *key, void *privdata = NULL);
+    bool Set(std::string_view key, std::string_view val, void *privdata = NULL);
+    bool Get(std::string_view key, void *privdata = NULL);
+    bool GetValue(std::string_view key, void *privdata = NULL);
+    template<typename T, typename = EnableIfTyped<T>>
+    bool Set(std::string_view key, const T &val, void *privdata = NULL);
+    void Cork();
+    int Uncork();
 public:
     bool Command(std::string key, void *privdata, const char *format, ...);
+    bool CommandArgv(std::string_view key, void *privdata, 
+                     int argc, const std::string_view *argv, 
+                     AsyncClusterCallback *callback = NULL);
+    bool FormattedCommand(std::string_view key, void *privdata, char *cmd, int cmdlen);
+    // thread-safe, once EnableSubmitQueue() was called on the loop thread.
+    // The loop dispatches the command with 'priority'
+    bool Submit(std::string_view key, void *privdata, 
+                int argc, const std::string_view *argv, 
+                CommandPriority priority = PRIORITY_INTERACTIVE);
+public:
+    // 'handler' completes this command instead of the callbacks. It is not 
+    // called when false is returned. A handler taking a RetainedReply * owns
+    // the reply, which is the way to keep it from a callback executor.
+    bool Get(std::string_view key, CompletionHandler handler);
+    bool Set(std::string_view key, std::string_view val, CompletionHandler handler);
+    bool CommandArgv(std::string_view key, int argc, const std::string_view *argv, 
+                     CompletionHandler handler);
+    // takes 'handler' only if it returns true
+    bool FormattedCommand(std::string_view key, CompletionHandler &handler, 
+                          char *cmd, int cmdlen);
+    // thread-safe like Submit(), the handler runs on the loop thread
+    bool Submit(std::string_view key, int argc, const std::string_view *argv, 
+                CompletionHandler handler, 
+                CommandPriority priority = PRIORITY_INTERACTIVE);
+    // a command that cannot be sent completes with an empty result
+    std::future<CommandResult> GetFuture(std::string_view key);
+    std::future<CommandResult> SubmitFuture(std::string_view key, int argc, 
+                                            const std::string_view *argv, 
+                                            CommandPriority priority = PRIORITY_INTERACTIVE);
     bool DoneCommand(redisReply *reply, void *acdata, bool if_free);
     bool RetryCommand(redisAsyncContext *retryContext, void *acdata);
     int RetryFailedCommands();
@@ -100,6 +238,7 @@ public:
     AsyncClusterData *PopFailedCommand();
     
     static ReplyType ProcessReply(redisReply *reply); 
+    static bool IsReadOnlyCommand(const char *cmd, int cmdlen);
     UpdatePoolType UpdatePool();
     
     static void OnCommand(redisAsyncContext *context, void *reply, void *acdata);
@@ -112,15 +251,180 @@ public:
     AsyncClusterPool *GetPool() { return _pool; }
     std::queue<AsyncClusterData *> *GetFailedCommands() { return _failedCommandQueue; }
     void SetCallback(AsyncClusterCallback *callback) { _callback = callback; }
+    AsyncClusterCallback *GetCallback() { return _callback; }
+    void SetSingleFlight(bool enable) { _singleFlight = enable; }
+    bool is_single_flight() { return _singleFlight; }
+    uint64_t GetSingleFlightHits() { return _singleFlightHits; }
+    bool is_corked() { return _corkDepth > 0; }
+    void SetFlowControl(const FlowControlOptions &opts, 
+                        CommandPriority priority = PRIORITY_INTERACTIVE);
+    // checks the lane of the current priority, OnLaneReady() follows a true
+    bool IsQueueFull(const std::string &key, uint32_t bytes = 0);
+    CommandResultType GetLastCommandResult() { return _lastResult; }
+    FlowControlMap *GetFlowControlMap(CommandPriority priority = PRIORITY_INTERACTIVE) 
+    { 
+        return _flowControlMap[priority]; 
+    }
+    void PrintFlowControl();
+    void SetSlabAllocation(bool enable);
+    SlabAllocator *GetSlab() { return _slab; }
+    // frames of the coroutines awaiting this cluster, see asynccoroutine.h
+    FramePool *GetFramePool();
+    void SetReplyArena(bool enable) { _replyArena = enable; }
+    void SetRespReader(bool enable) { _respReader = enable; }
+    // set before Connect(), routes against the process-wide topology
+    void SetSharedTopology(bool enable) { _sharedTopology = enable; }
+    // set before Connect(), the slots of a node are spread over 'count' 
+    // connections, the commands of a slot always share one
+    void SetConnectionsPerNode(uint32_t count);
+    uint32_t GetConnectionsPerNode();
+    // set before Connect(), every priority gets its own connections
+    void SetPriorityLanes(bool enable);
+    // priority of the commands issued from now on
+    void SetPriority(CommandPriority priority) { _priority = priority; }
+    CommandPriority GetPriority() { return _priority; }
+    void SetCompressor(ValueCompressor *compressor) { _compressor = compressor; }
+    ValueCompressor *GetCompressor() { return _compressor; }
+    // loop thread only, from the reply callback
+    RetainedReply *RetainReply(redisReply *reply);
+    void EnableSubmitQueue(size_t capacity = SUBMIT_QUEUE_CAPACITY, 
+                           size_t batch = SUBMIT_QUEUE_BATCH);
+    SubmitQueue *GetSubmitQueue() { return _submitQueue; }
+    // callbacks run on the executor instead of the loop thread, 'ordered' 
+    // keeps the completion order of each slot. The executor must be stopped
+    // before the cluster is deleted.
+    void SetCallbackExecutor(CallbackExecutor *executor, bool ordered = true) 
+    { 
+        _executor = executor; 
+        _executorOrdered = ordered; 
+    }
+    CallbackExecutor *GetCallbackExecutor() { return _executor; }
+    // set before Connect(), node connections are attached to 'loop' through
+    // 'attach' instead of the libevent base, see asiocluster.h. RespReader,
+    // the submit queue and the writers that need a timer stay libevent only.
+    void SetEventLoop(EventAttachFn *attach, void *loop) 
+    { 
+        _eventAttach = attach; 
+        _eventLoop = loop; 
+    }
+private:
+    void AttachNode(ClusterNodeData *nodeData);
+    void AttachContext(redisAsyncContext *context);
+    bool DispatchCommand(std::string_view key, void *privdata, 
+                         char *cmd, int cmdlen, ArgvCommand *argv, 
+                         int flags = 0, 
+                         AsyncClusterCallback *callback = NULL, 
+                         CompletionHandler *handler = NULL);
+    bool DispatchArgv(std::string_view key, void *privdata, 
+                      int argc, const std::string_view *argv, 
+                      AsyncClusterCallback *callback, 
+                      CompletionHandler *handler, 
+                      bool copy = false);
+    bool DispatchSet(std::string_view key, std::string_view val, void *privdata, 
+                     CompletionHandler *handler, bool copy);
+    bool DispatchGet(std::string_view key, CompletionHandler &handler);
+    bool PushSubmitted(std::string_view key, void *privdata, 
+                       int argc, const std::string_view *argv, 
+                       CompletionHandler &handler, CommandPriority priority);
+    CompletionHandler PromiseHandler(std::promise<CommandResult> &&promise);
+    bool SendArgvCommand(redisAsyncContext *context, AsyncClusterData *acData);
+    AsyncClusterData *NewCommandData(char *cmd, Slot index, uint32_t cmdlen, 
+                                     void *privdata);
+    void FreeCommandData(AsyncClusterData *acData);
+    void FinishSingleFlight(AsyncClusterData *acData);
+    void EvictSingleFlight(std::string_view key);
+    static std::string SingleFlightKey(const char *cmd, int cmdlen, 
+                                       CommandPriority priority);
+    void ReleaseFlow(AsyncClusterData *acData, bool failed);
+    void PostCallback(AsyncClusterCallback *callback, redisReply *reply, 
+                      AsyncClusterData *acData);
+    static void RunCallback(void *task);
 private:
     struct event_base *_ev_base;
+    EventAttachFn *_eventAttach;
+    void *_eventLoop;
     AsyncClusterPool *_pool;
     AsyncClusterCallback *_callback;
     std::queue<AsyncClusterData *> *_failedCommandQueue;
+    SingleFlightMap *_singleFlightMap;
+    SingleFlightKeyMap *_singleFlightKeys; // in-flight reads by key
+    uint64_t _singleFlightHits;
+    bool _singleFlight;
+    std::vector<AsyncClusterData *> *_corkedCommands;
+    uint32_t _corkDepth;
+    FlowControlOptions _flowOptions[PRIORITY_COUNT];
+    FlowControlMap *_flowControlMap[PRIORITY_COUNT];
+    bool _flowControl[PRIORITY_COUNT];
+    CommandPriority _priority;
+    CommandResultType _lastResult;
+    SlabAllocator *_slab;
+    FramePool *_framePool;
+    bool _useSlab;
+    bool _replyArena;
+    ReplyArenaMap *_replyArenas;
+    ReplyArena *_currentArena;  // arena of the reply being dispatched
+    redisReply *_currentReply;  // root of that reply
+    bool _respReader;
+    bool _sharedTopology;
+    ValueCompressor *_compressor;
+    SubmitQueue *_submitQueue;
+    CallbackExecutor *_executor;
+    bool _executorOrdered;
     char _ip[32];
 	int _port;
     bool _debug;
     bool _running;
 };
 
+// Corks the AsyncCluster for the lifetime of the scope.
+class AsyncClusterBatch
+{
+public:
+    AsyncClusterBatch(AsyncCluster *asyncCluster) : _asyncCluster(asyncCluster) 
+    {
+        _asyncCluster->Cork();
+    }
+    ~AsyncClusterBatch() { _asyncCluster->Uncork(); }
+    AsyncClusterBatch(const AsyncClusterBatch &) = delete;
+    AsyncClusterBatch& operator=(const AsyncClusterBatch &) = delete;
+private:
+    AsyncCluster *_asyncCluster;
+};
+
+// Issues the commands of the scope with the given priority.
+class AsyncClusterPriority
+{
+public:
+    AsyncClusterPriority(AsyncCluster *asyncCluster, CommandPriority priority) 
+        : _asyncCluster(asyncCluster), _previous(asyncCluster->GetPriority())
+    {
+        _asyncCluster->SetPriority(priority);
+    }
+    ~AsyncClusterPriority() { _asyncCluster->SetPriority(_previous); }
+    AsyncClusterPriority(const AsyncClusterPriority &) = delete;
+    AsyncClusterPriority& operator=(const AsyncClusterPriority &) = delete;
+private:
+    AsyncCluster *_asyncCluster;
+    CommandPriority _previous;
+};
+
+// decode GetValue() results with ValueTraits<T>::Read() in OnValue()
+template<typename T, typename>
+bool AsyncCluster::Set(std::string_view key, const T &val, void *privdata)
+{
+    if (_compressor) {
+        std::string value(ValueTraits<T>::Size(val), '\0');
+        ValueTraits<T>::Write(&value[0], val);
+        return DispatchSet(key, value, privdata, NULL, true);
+    }
+
+    char *cmd;
+    int cmdlen = RespSet::FormatValue(&cmd, &key, val);
+    _lastResult = COMMAND_FAILED;
+    if (cmdlen < 0) {
+        return false;
+    }
+    return DispatchCommand(key, privdata, cmd, cmdlen, NULL);
+}
+
 } // RedisClusterAPI
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "callbackexecutor.h"
+
+namespace RedisClusterAPI
+{
+
+// worker running on this thread, tasks it posts stay in its own deque
+struct ExecutorWorker
+{
+    CallbackExecutor *executor;
+    int index;
+};
+
+static thread_local ExecutorWorker _currentWorker = { NULL, -1 };
+
+CallbackExecutor::CallbackExecutor(int threads, int strands)
+    : _pending(0), _sleeping(0), _stopping(false), _next(0), _executed(0), _steals(0)
+{
+    if (threads <= 0) {
+        threads = std::thread::hardware_concurrency();
+        threads = threads > 0 ? threads : 1;
+    }
+    if (strands <= 0) {
+        strands = 1;
+    }
+
+    _queues = new std::vector<WorkerQueue *>();
+    for (int i = 0; i < threads; i++) {
+        _queues->push_back(new WorkerQueue());
+    }
+    _strands = new std::vector<Strand *>();
+    for (int i = 0; i < strands; i++) {
+        Strand *strand = new Strand();
+        strand->executor = this;
+        strand->scheduled = false;
+        _strands->push_back(strand);
+    }
+    _threads = new std::vector<std::thread *>();
+    for (int i = 0; i < threads; i++) {
+        _threads->push_back(new std::thread(&CallbackExecutor::Run, this, i));
+    }
+}
+
+CallbackExecutor::~CallbackExecutor()
+{
+    Stop();
+
+    for (size_t i = 0; i < _queues->size(); i++) {
+        delete (*_queues)[i];
+    }
+    delete _queues;
+    _queues = NULL;
+    for (size_t i = 0; i < _strands->size(); i++) {
+        delete (*_strands)[i];
+    }
+    delete _strands;
+    _strands = NULL;
+    delete _threads;
+    _threads = NULL;
+}
+
+void CallbackExecutor::Post(ExecutorFn *fn, void *arg)
+{
+    int index;
+    if (_currentWorker.executor == this) {
+        index = _currentWorker.index;
+    } else {
+        index = _next.fetch_add(1, std::memory_order_relaxed) % _queues->size();
+    }
+
+    // counted first, so '_pending' never goes below the queued tasks.
+    // seq_cst, pairs with the increment of '_sleeping' in Run()
+    _pending.fetch_add(1);
+    WorkerQueue *queue = (*_queues)[index];
+    {
+        std::lock_guard<std::mutex> lock(queue->lock);
+        queue->tasks.push_back({ fn, arg });
+    }
+
+    if (_sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(_idleLock);
+        _idleCond.notify_one();
+    }
+}
+
+void CallbackExecutor::PostOrdered(uint32_t key, ExecutorFn *fn, void *arg)
+{
+    Strand *strand = (*_strands)[key % _strands->size()];
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(strand->lock);
+        strand->tasks.push_back({ fn, arg });
+        if (strand->scheduled == false) {
+            strand->scheduled = true;
+            schedule = true;
+        }
+    }
+    if (schedule) {
+        Post(RunStrand, strand);
+    }
+}
+
+// runs every task posted so far, then joins the workers
+void CallbackExecutor::Stop()
+{
+    if (_threads->empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_idleLock);
+        _stopping = true;
+        _idleCond.notify_all();
+    }
+    for (size_t i = 0; i < _threads->size(); i++) {
+        (*_threads)[i]->join();
+        delete (*_threads)[i];
+    }
+    _threads->clear();
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+void CallbackExecutor::Run(int index)
+{
+    _currentWorker.executor = this;
+    _currentWorker.index = index;
+
+    ExecutorTask task;
+    while (true) {
+        if (TryPop(index, task)) {
+            task.fn(task.arg);
+            _executed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_idleLock);
+        _sleeping.fetch_add(1);
+        while (_pending.load() == 0 && _stopping == false) {
+            _idleCond.wait(lock);
+        }
+        _sleeping.fetch_sub(1);
+        if (_pending.load() == 0 && _stopping) {
+            break;
+        }
+    }
+
+    _currentWorker.executor = NULL;
+    _currentWorker.index = -1;
+}
+
+// own deque from the back, the others from the front
+bool CallbackExecutor::TryPop(int index, ExecutorTask &task)
+{
+    size_t count = _queues->size();
+    for (size_t i = 0; i < count; i++) {
+        WorkerQueue *queue = (*_queues)[(index + i) % count];
+        std::lock_guard<std::mutex> lock(queue->lock);
+        if (queue->tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            task = queue->tasks.back();
+            queue->tasks.pop_back();
+        } else {
+            task = queue->tasks.front();
+            queue->tasks.pop_front();
+            _steals.fetch_add(1, std::memory_order_relaxed);
+        }
+        _pending.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void CallbackExecutor::RunStrand(void *arg)
+{
+    Strand *strand = (Strand *)arg;
+    ExecutorTask task;
+
+    for (int i = 0; i < EXECUTOR_STRAND_BUDGET; i++) {
+        {
+            std::lock_guard<std::mutex> lock(strand->lock);
+            if (strand->tasks.empty()) {
+                strand->scheduled = false;
+                return;
+            }
+            task = strand->tasks.front();
+            strand->tasks.pop_front();
+        }
+        task.fn(task.arg);
+    }
+
+    // still scheduled, the other strands get their turn first
+    strand->executor->Post(RunStrand, strand);
+}
+
+} // RedisClusterAPI
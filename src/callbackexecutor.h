@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#define EXECUTOR_STRAND_COUNT 1024
+#define EXECUTOR_STRAND_BUDGET 64
+
+namespace RedisClusterAPI
+{
+
+typedef void (ExecutorFn)(void *arg);
+
+struct ExecutorTask
+{
+    ExecutorFn *fn;
+    void *arg;
+};
+
+// Work-stealing thread pool running the callbacks of an AsyncCluster off
+// its event loop.
+//   Every worker owns a deque: it pops its own tasks from the back and steals
+// from the front of the others when it runs dry, idle workers sleep until a
+// task is posted. PostOrdered() serializes the tasks of the same key through
+// a strand: at most one worker runs a strand at a time, in posting order,
+// and a busy strand is posted again after EXECUTOR_STRAND_BUDGET tasks so it
+// cannot starve the others. Strands still move between workers.
+class CallbackExecutor
+{
+public:
+    CallbackExecutor(int threads = 0, int strands = EXECUTOR_STRAND_COUNT);
+    ~CallbackExecutor();
+    CallbackExecutor(const CallbackExecutor &) = delete;
+    CallbackExecutor& operator=(const CallbackExecutor &) = delete;
+
+    void Post(ExecutorFn *fn, void *arg);
+    void PostOrdered(uint32_t key, ExecutorFn *fn, void *arg);
+    void Stop();
+public:
+    int GetThreadCount() { return (int)_threads->size(); }
+    uint64_t GetExecutedCount() { return _executed.load(std::memory_order_relaxed); }
+    uint64_t GetStealCount() { return _steals.load(std::memory_order_relaxed); }
+private:
+    struct WorkerQueue {
+        std::mutex lock;
+        std::deque<ExecutorTask> tasks;
+    };
+    struct Strand {
+        CallbackExecutor *executor;
+        std::mutex lock;
+        std::deque<ExecutorTask> tasks;
+        bool scheduled;
+    };
+private:
+    void Run(int index);
+    bool TryPop(int index, ExecutorTask &task);
+    static void RunStrand(void *arg);
+private:
+    std::vector<WorkerQueue *> *_queues;
+    std::vector<Strand *> *_strands;
+    std::vector<std::thread *> *_threads;
+    std::mutex _idleLock;
+    std::condition_variable _idleCond;
+    std::atomic<int64_t> _pending;     // tasks in the worker queues
+    std::atomic<int> _sleeping;
+    std::atomic<bool> _stopping;
+    std::atomic<uint32_t> _next;
+    std::atomic<uint64_t> _executed;
+    std::atomic<uint64_t> _steals;
+};
+
+} // RedisClusterAPI
@@ -4,13 +4,12 @@ namespace RedisClusterAPI
 {
 
 Cluster::Cluster(const char *ip, int port, int connect_timeout, int command_timeout, bool debug)
-    : _port(port), _debug(debug)
+    : _port(port), _debug(debug), _respReader(false), _sharedTopology(false), 
+      _compressor(NULL)
 {
     memset(_ip, 0, sizeof(_ip));
 	strncpy(_ip, ip, strlen(ip));
-    _pool = new SyncClusterPool(connect_timeout, command_timeout,
-                                (ConnectFn *)redisConnect, 
-                                (FreeConnectFn *)redisFree);
+    _pool = new SyncClusterPool(connect_timeout, command_timeout);
 }
 
 Cluster::~Cluster() 
@@ -20,6 +19,9 @@ Cluster::~Cluster()
 
 bool Cluster::Connect()
 {
+    if (_sharedTopology) {
+        _pool->ShareTopology(_ip, _port);
+    }
     UpdatePoolType res = _pool->InitPool(_ip, _port);
     if (res == UPDATE_FALSE || res == UPDATE_UNCHANGED) {
         return false;
@@ -56,7 +58,17 @@ bool Cluster::PingALL()
 
 bool Cluster::Set(const char *key, const char *val)
 {
-    redisReply *reply = static_cast<redisReply *>(Command(key, "SET %s %s", key, val));
+    std::string_view value(val);
+    if (_compressor && !_compressor->Encode(key, value, value)) {
+        return false;
+    }
+    char *cmd;
+    int cmdlen = RespSet::Format(&cmd, key, value);
+    if (cmdlen < 0) {
+        return false;
+    }
+    redisReply *reply = FormattedCommand(key, cmd, cmdlen);
+    free(cmd);
     if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
         return false;
     }
@@ -66,15 +78,147 @@ bool Cluster::Set(const char *key, const char *val)
 
 bool Cluster::Get(const char *key, std::string &output)
 {
-    redisReply *reply = static_cast<redisReply *>(Command(key, "GET %s", key));
+    char *cmd;
+    int cmdlen = RespGet::Format(&cmd, key);
+    if (cmdlen < 0) {
+        return false;
+    }
+    redisReply *reply = FormattedCommand(key, cmd, cmdlen);
+    free(cmd);
+    if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
+        return false;
+    }
+    bool res = AssignValue(reply, output);
+    freeReplyObject(reply);
+    return res;
+}
+
+bool Cluster::Set(std::string_view key, std::string_view val)
+{
+    if (_compressor && !_compressor->Encode(key, val, val)) {
+        return false;
+    }
+    std::string_view argv[3] = { "SET", key, val };
+    redisReply *reply = CommandArgv(key, 3, argv);
     if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
+        freeReplyObject(reply);
         return false;
     }
-    output.assign(reply->str);
     freeReplyObject(reply);
     return true;
 }
 
+bool Cluster::Get(std::string_view key, std::string &output)
+{
+    std::string_view argv[2] = { "GET", key };
+    redisReply *reply = CommandArgv(key, 2, argv);
+    if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
+        freeReplyObject(reply);
+        return false;
+    }
+    bool res = AssignValue(reply, output);
+    freeReplyObject(reply);
+    return res;
+}
+
+//   The values below are handed over while still in the read buffer of the 
+// context, a nil reply leaves the destination untouched.
+bool Cluster::Get(std::string_view key, char *buf, size_t size, size_t *len)
+{
+    ValueBuffer buffer = { buf, size, 0 };
+    if (!Get(key, CopyToBuffer, &buffer)) {
+        return false;
+    }
+    *len = buffer.len;
+    return buffer.len <= size;
+}
+
+bool Cluster::Get(std::string_view key, std::pmr::string &output)
+{
+    return Get(key, CopyToString, &output);
+}
+
+bool Cluster::Get(std::string_view key, ValueCallback *callback, void *privdata)
+{
+    std::string_view argv[2] = { "GET", key };
+    DecodedValue decoded = { callback, privdata, _compressor, false };
+    ValueSink sink(_compressor ? DecodeValue : callback, 
+                   _compressor ? (void *)&decoded : privdata);
+    redisReply *reply = CommandArgv(key, 2, argv, &sink);
+    if (reply == NULL || reply->type != REDIS_REPLY_STRING || decoded.failed) {
+        freeReplyObject(reply);
+        return false;
+    }
+    freeReplyObject(reply);
+    // a nil reply never reached the callback
+    return sink.IsDelivered();
+}
+
+redisReply *Cluster::CommandArgv(std::string_view key, 
+                                 int argc, 
+                                 const std::string_view *argv)
+{
+    return CommandArgv(key, argc, argv, NULL);
+}
+
+redisReply *Cluster::CommandArgv(std::string_view key, 
+                                 int argc, 
+                                 const std::string_view *argv, 
+                                 ValueSink *sink)
+{
+    ArgvCommand argvCmd(argc, argv);
+    Slot index = SlotHash::slotByKey(key.data(), key.length());
+    redisReply *reply = NULL;
+    bool updated = false;
+
+    // another client refreshed the shared topology
+    if (_pool->IsStale()) {
+        _pool->UpdatePool();
+    }
+
+    while (true) {
+        ClusterNode *node = _pool->GetNodeBySlot(index);
+        if (node && SendArgvCommand(node->second.context, &argvCmd) &&
+                GetReply(node->second.context, &reply, sink) == REDIS_OK) {
+            const char *ip;
+            int port;
+            int state = processReply(reply, ip, port);
+            if (state == ASK) {
+                redisReply *asked = Ask(ip, port, NULL, 0, &argvCmd, sink);
+                freeReplyObject(reply);
+                return asked;
+            }
+            if (state != MOVED || updated) {
+                return reply;
+            }
+            // the slot moved, refresh and retry once
+            freeReplyObject(reply);
+            reply = NULL;
+        } else if (node) {
+            ResetContext(node);
+        }
+
+        // if updated the pool, still fails to send command
+        if (updated) {
+            break;
+        }
+
+        UpdatePoolType res = _pool->UpdatePool();
+        // new master hasn't been elected yet, fails to send command
+        if (res == UPDATE_FALSE || res == UPDATE_UNCHANGED) {
+            break;
+        }
+
+        if (_debug) {
+            printf("[POOL UPDATED]\n");
+        }
+
+        // new master has been elected, try to send the command again
+        updated = true;
+    }
+    return NULL;
+}
+
 int Cluster::processReply(const redisReply *reply, const char *&ip, int &port)
 {
     if (reply == NULL || reply->str == NULL) {
@@ -82,23 +226,34 @@ int Cluster::processReply(const redisReply *reply, const char *&ip, int &port)
     }
 
     if (reply->type == REDIS_REPLY_ERROR) {
-        if (strcmp(reply->str, "CLUSTERDOWN") == 0) {
+        if (strncmp(reply->str, "CLUSTERDOWN", 11) == 0) {
             return CLUSTERDOWN;
+        }
+        //   "MOVED <slot> <ip>:<port>" and "ASK <slot> <ip>:<port>" are split
+        // in place, any other error is left as it is
+        int state;
+        if (strncmp(reply->str, "MOVED ", 6) == 0) {
+            state = MOVED;
+        } else if (strncmp(reply->str, "ASK ", 4) == 0) {
+            state = ASK;
         } else {
-            char *ptr1 = reply->str, *ptr2;
-            ptr2 = strchr(ptr1, ' ');
-            ptr1 = strchr(ptr2 + 1, ' ');
-            *ptr1 = '\0';
-            ptr2 = strrchr(ptr1 + 1, ':');
-            *ptr2 = '\0';
-            ip = ptr1 + 1;
-            port = atoi(ptr2 + 1);
-            if (strncmp(reply->str, "MOVED", 5) == 0) {
-                return MOVED;
-            } else if (strcmp(reply->str, "ASK") == 0) {
-                return ASK;
-            }
+            return OK;
+        }
+        char *ptr1 = reply->str, *ptr2;
+        ptr2 = strchr(ptr1, ' ');
+        ptr1 = strchr(ptr2 + 1, ' ');
+        if (ptr1 == NULL) {
+            return FAILED;
         }
+        *ptr1 = '\0';
+        ptr2 = strrchr(ptr1 + 1, ':');
+        if (ptr2 == NULL) {
+            return FAILED;
+        }
+        *ptr2 = '\0';
+        ip = ptr1 + 1;
+        port = atoi(ptr2 + 1);
+        return state;
     }
     return OK;
 }
@@ -107,12 +262,27 @@ int Cluster::processReply(const redisReply *reply, const char *&ip, int &port)
 
 redisReply *Cluster::Command(std::string key, const char *format, ...)
 {
-    UpdatePoolType flag;
     va_list ap;
     va_start(ap, format);
+
+    char *cmd;
+    int cmdlen = redisvFormatCommand(&cmd, format, ap);
+    va_end(ap);
+    if (cmdlen < 0) {
+        return NULL;
+    }
+
+    redisReply *reply = FormattedCommand(key, cmd, cmdlen);
+    free(cmd);
+    return reply;
+}
+
+redisReply *Cluster::FormattedCommand(std::string key, const char *cmd, int cmdlen)
+{
+    UpdatePoolType flag;
     
     redisReply *reply = NULL;
-    DoneCommand(key, format, ap, &reply);
+    DoneCommand(key, cmd, cmdlen, &reply);
     if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
         exit(EXIT_FAILURE);
     }
@@ -137,7 +307,7 @@ redisReply *Cluster::Command(std::string key, const char *format, ...)
         if (flag == UPDATE_FALSE || flag == UPDATE_UNCHANGED) {
             exit(EXIT_FAILURE);
         }
-        DoneCommand(key, format, ap, &reply); // TODO: ap is changed?
+        DoneCommand(key, cmd, cmdlen, &reply);
         if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
             freeReplyObject(reply);
             return NULL;
@@ -145,39 +315,68 @@ redisReply *Cluster::Command(std::string key, const char *format, ...)
 
     } else if (state == ASK) {
 
+        // 'ip' points into the ASK error, it is freed after the redirect
+        redisReply *asked = Ask(ip, port, cmd, cmdlen, NULL, NULL);
         freeReplyObject(reply);
-
-        redisContext *newcontext = redisConnect(ip, port);
-        reply = (redisReply *)redisCommand(newcontext, "ASKING");
-        if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
-            freeReplyObject(reply);
-            return NULL;
-        }
-        freeReplyObject(reply);
-        // DoneCommand();
-        if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
-            return NULL;
-        }
+        reply = asked;
 
     } else if (state == CLUSTERDOWN) {
         printf("[cluster down]\n");
     }
     
-    va_end(ap);
     return reply;
 }
 
+bool Cluster::SendArgvCommand(redisContext *context, ArgvCommand *argv)
+{
+    if (argv->IsZeroCopy() == false) {
+        char *cmd = argv->Format();
+        if (cmd == NULL) {
+            return false;
+        }
+        int flag = redisAppendFormattedCommand(context, cmd, argv->GetLength());
+        free(cmd);
+        return flag == REDIS_OK;
+    }
+
+    //   The connection is blocking: flush what is queued, then write the
+    // command with writev() straight from the caller's memory.
+    int done = 0;
+    do {
+        if (redisBufferWrite(context, &done) == REDIS_ERR) {
+            return false;
+        }
+    } while (!done);
+
+    size_t offset = 0;
+    while (offset < argv->GetLength()) {
+        //   Nothing written on a blocking socket means the send timed out.
+        // Part of the command may be on the wire, so the connection is
+        // marked broken like hiredis does on a failed write.
+        ssize_t nwritten = argv->Write(context->fd, offset);
+        if (nwritten <= 0) {
+            context->err = REDIS_ERR_IO;
+            snprintf(context->errstr, sizeof(context->errstr), "%s",
+                     nwritten < 0 ? strerror(errno) : "short write");
+            return false;
+        }
+        offset += nwritten;
+    }
+    return true;
+}
+
 void Cluster::DoneCommand(std::string key, 
-                          const char *format, 
-                          va_list ap, 
+                          const char *cmd, 
+                          int cmdlen, 
                           redisReply **reply)
 {
     int flag;
-    char *cmd;
-    int cmdlen = redisvFormatCommand(&cmd, format, ap);
     bool updated = false;
     
     ClusterNode *node = NULL;
+    if (_pool->IsStale()) {
+        _pool->UpdatePool();
+    }
     while (true) {
         node = _pool->GetNodeByKey(&key);
 
@@ -186,7 +385,7 @@ void Cluster::DoneCommand(std::string key,
             printf("[redisAppendFormattedCommand ERROR]\n");
         }
 
-        flag = redisGetReply(node->second.context, (void **)reply);
+        flag = GetReply(node->second.context, reply);
         if (flag == REDIS_ERR) {
             freeReplyObject(*reply);
 
@@ -210,14 +409,108 @@ void Cluster::DoneCommand(std::string key,
             continue;
         } else {
             // only when redisGetReply() successed
-            free(cmd);
             return;
         }
     }
     // fails to send command
     *reply = NULL;
-    free(cmd);
     return;
 }
 
+// the slot is being migrated, the command ('cmd', or 'argv' if set) goes 
+// once to the importing node
+redisReply *Cluster::Ask(const char *ip, 
+                         int port, 
+                         const char *cmd, 
+                         int cmdlen, 
+                         ArgvCommand *argv, 
+                         ValueSink *sink)
+{
+    redisContext *context = _pool->Connect(ip, port);
+    if (context == NULL) {
+        return NULL;
+    }
+
+    redisReply *reply = NULL;
+    redisAppendCommand(context, "ASKING");
+    bool sent = argv ? SendArgvCommand(context, argv) : 
+                redisAppendFormattedCommand(context, cmd, cmdlen) == REDIS_OK;
+    if (sent && GetReply(context, &reply) == REDIS_OK) {
+        freeReplyObject(reply);
+        reply = NULL;
+        if (GetReply(context, &reply, sink) != REDIS_OK) {
+            reply = NULL;
+        }
+    }
+    SyncClusterPool::Free(context);
+    return reply;
+}
+
+// a connection left in error (a short write, a timeout) is replaced, the 
+// pool only reconnects the nodes on a topology change
+void Cluster::ResetContext(ClusterNode *node)
+{
+    redisContext *&context = node->second.context;
+    if (context == NULL || context->err == 0) {
+        return;
+    }
+    redisContext *fresh = _pool->Connect(node->second.ip, node->second.port);
+    if (fresh) {
+        SyncClusterPool::Free(context);
+        context = fresh;
+    }
+}
+
+int Cluster::GetReply(redisContext *context, redisReply **reply, ValueSink *sink)
+{
+    int res;
+    if (sink) {
+        sink->Attach(context);
+    }
+    if (_respReader) {
+        res = RespReader::GetReply(context, (void **)reply);
+    } else {
+        res = redisGetReply(context, (void **)reply);
+    }
+    if (sink) {
+        sink->Detach(context);
+    }
+    return res;
+}
+
+void Cluster::CopyToBuffer(std::string_view value, void *buffer)
+{
+    ValueBuffer *dest = (ValueBuffer *)buffer;
+    dest->len = value.length();
+    if (value.length() <= dest->size) {
+        memcpy(dest->buf, value.data(), value.length());
+    }
+}
+
+void Cluster::DecodeValue(std::string_view value, void *decoded)
+{
+    DecodedValue *dest = (DecodedValue *)decoded;
+    if (dest->compressor->Decode(value, value) == false) {
+        dest->failed = true;
+        return;
+    }
+    dest->callback(value, dest->privdata);
+}
+
+bool Cluster::AssignValue(const redisReply *reply, std::string &output)
+{
+    std::string_view value(reply->str ? reply->str : "", reply->len);
+    if (_compressor && reply->type == REDIS_REPLY_STRING && 
+            !_compressor->Decode(value, value)) {
+        return false;
+    }
+    output.assign(value.data(), value.size());
+    return true;
+}
+
+void Cluster::CopyToString(std::string_view value, void *output)
+{
+    ((std::pmr::string *)output)->assign(value.data(), value.length());
+}
+
 } // RedisClusterAPI
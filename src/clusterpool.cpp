@@ -4,19 +4,14 @@ namespace RedisClusterAPI
 {
 
 template<typename CONTEXT>
-ClusterPool<CONTEXT>::ClusterPool(int connect_timeout, 
-                                  int command_timeout,
-                                  ConnectFn *connectFn,
-                                  FreeConnectFn *freeConnectFn)
-    : _connectFn(connectFn), 
-      _freeConnectFn(freeConnectFn),
+ClusterPool<CONTEXT>::ClusterPool(int connect_timeout, int command_timeout)
+    : _topology(NULL),
+      _topologyVersion(0),
+      _stripes(1),
+      _lanes(1),
       _connect_timeout(connect_timeout),
       _command_timeout(command_timeout)
 {
-    if (connectFn == NULL || freeConnectFn == NULL) {
-        exit(EXIT_FAILURE);
-    }
-
     _mapPool = new MapPool();
 }
 
@@ -25,20 +20,25 @@ ClusterPool<CONTEXT>::~ClusterPool()
 {   
     ClearPool(_mapPool);
     delete _mapPool;
+    SharedTopology::Release(_topology);
+    _topology = NULL;
 }
 
 template<typename CONTEXT>
 UpdatePoolType ClusterPool<CONTEXT>::InitPool(const char *ip, int port)
 {
-    redisContext *context = NULL;
+    if (_topology) {
+        if (_topology->GetVersion() == 0 && _topology->Refresh(0) == UPDATE_FALSE) {
+            return UPDATE_FALSE;
+        }
+        return InitPoolFromTopology();
+    }
+
     redisReply *reply = NULL;
 
-    if (_connect_timeout > 0) {
-        context = redisConnectWithTimeout(ip, port, {_connect_timeout, 0});
-    } else {
-        context = redisConnect(ip, port);
-    }
-    
+    // CLUSTER SLOTS is always fetched over a blocking connection
+    ContextOptions opts(ip, port, _connect_timeout, _command_timeout);
+    redisContext *context = ContextPolicy<redisContext>::Connect(opts);
     if (context == NULL || context->err) {
         if (context) {
             redisFree(context);
@@ -46,10 +46,6 @@ UpdatePoolType ClusterPool<CONTEXT>::InitPool(const char *ip, int port)
         return UPDATE_FALSE;
     }
 
-    if (_command_timeout > 0) {
-        redisSetTimeout(context, {_command_timeout, 0});
-    }
-
     reply = (redisReply *)(redisCommand(context, REDIS_COMMAND_CLUSTER_SLOTS));
     if (reply == NULL) {
         redisFree(context);
@@ -135,19 +131,39 @@ bool ClusterPool<CONTEXT>::InitNode(ClusterNodeData &node,
                                     int port, 
                                     const char *id)
 {
-    Context *context = _connectFn(ip, port);
+    Context *context = Connect(ip, port);
     if (context == NULL) {
         return false;
     }
-    if (context->err) {
-        _freeConnectFn(context);
-        return false;
-    }
 
     node = ClusterNodeData(false, ip, port, id, context);
+    node.laneCount = _lanes;
+    for (uint32_t i = 1; i < _stripes * _lanes; i++) {
+        context = Connect(ip, port);
+        if (context == NULL) {
+            ClearNode(node);
+            return false;
+        }
+        node.stripes.push_back(context);
+    }
     return true;
 }
 
+template<typename CONTEXT>
+auto ClusterPool<CONTEXT>::Connect(const char *ip, int port) -> Context *
+{
+    ContextOptions opts(ip, port, _connect_timeout, _command_timeout);
+    Context *context = Policy::Connect(opts);
+    if (context == NULL) {
+        return NULL;
+    }
+    if (context->err) {
+        Policy::Free(context);
+        return NULL;
+    }
+    return context;
+}
+
 template<typename CONTEXT>
 bool ClusterPool<CONTEXT>::InsertNode(MapPool *mapPool, 
                                       SlotRange slots, 
@@ -190,7 +206,7 @@ auto ClusterPool<CONTEXT>::GetNodeByCtx(const Context *context) -> ClusterNode *
 {
     typename MapPool::iterator it;
     for (it = _mapPool->begin(); it != _mapPool->end(); it++) {
-        if (context == it->second.context) {
+        if (it->second.HasContext(context)) {
             return (ClusterNode *) &(*it);
         }
     }
@@ -212,6 +228,17 @@ auto ClusterPool<CONTEXT>::GetNodeByID(const char *id) -> ClusterNode *
 template<typename CONTEXT>
 UpdatePoolType ClusterPool<CONTEXT>::UpdatePool()
 {
+    // another client may have published a newer topology already
+    if (_topology) {
+        if (IsStale() == false) {
+            UpdatePoolType res = _topology->Refresh(_topologyVersion);
+            if (res != UPDATE_TRUE) {
+                return res;
+            }
+        }
+        return InitPoolFromTopology();
+    }
+
     int res;
     ClusterNodeData *nodeData;
 
@@ -229,6 +256,17 @@ UpdatePoolType ClusterPool<CONTEXT>::UpdatePool()
     return UPDATE_FALSE;
 }
 
+// Routes against the process-wide topology of the seed from now on, set 
+// before InitPool(). Node connections stay per pool.
+template<typename CONTEXT>
+bool ClusterPool<CONTEXT>::ShareTopology(const char *ip, int port)
+{
+    if (_topology == NULL) {
+        _topology = SharedTopology::Acquire(ip, port, _connect_timeout, _command_timeout);
+    }
+    return _topology != NULL;
+}
+
 template<typename CONTEXT>
 bool ClusterPool<CONTEXT>::IsSamePool(const redisReply *reply)
 {
@@ -252,37 +290,148 @@ bool ClusterPool<CONTEXT>::IsSamePool(const redisReply *reply)
         }
         ClusterNodeData &nodeData = node->second;
         
-        if (strncmp(nodeData.id, id, 41) || strncmp(nodeData.ip, ip, 16) || nodeData.port != port) {
+        if (strncmp(nodeData.id, id, 41) || strncmp(nodeData.ip, ip, sizeof(nodeData.ip)) || nodeData.port != port) {
             return false;
         }
     }
     return true;
 }
 
+//   Rebuilds the pool from the latest snapshot, the nodes are copied out 
+// first so no connection is opened inside the read section. A node that kept 
+// its id and address keeps its healthy connections, only new or broken nodes 
+// are connected. Each old entry is taken once since every slot range of a 
+// node has its own connections.
 template<typename CONTEXT>
-void ClusterPool<CONTEXT>::ClearPool(MapPool *mapPool)
+UpdatePoolType ClusterPool<CONTEXT>::InitPoolFromTopology()
 {
-    ClusterNodeData *nodeData = NULL;
-    
-    int count = 1;
-    typename MapPool::iterator it;
-    for (it = mapPool->begin(); it != mapPool->end(); it++) {
-        nodeData = &(it->second);
-        if (nodeData && nodeData->context) {
-            try {
-                _freeConnectFn(nodeData->context);
+    std::vector<TopologyNode> nodes;
+    uint64_t version;
+    {
+        TopologyReader reader(_topology);
+        const TopologySnapshot *snapshot = reader.Get();
+        if (snapshot == NULL) {
+            return UPDATE_FALSE;
+        }
+        if (snapshot->version == _topologyVersion) {
+            return UPDATE_UNCHANGED;
+        }
+        version = snapshot->version;
+        nodes = snapshot->nodes;
+    }
+
+    std::vector<ClusterNodeData *> kept(nodes.size(), NULL);
+    std::vector<ClusterNodeData> fresh(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        kept[i] = FindReusableNode(nodes[i], kept);
+        if (kept[i] != NULL) {
+            continue;
+        }
+        if (InitNode(fresh[i], nodes[i].ip, nodes[i].port, nodes[i].id) == false) {
+            for (size_t j = 0; j < i; j++) {
+                if (kept[j] == NULL) {
+                    ClearNode(fresh[j]);
+                }
             }
-            catch(const std::exception& e) {
-                std::cerr << "[ClearPool() | free() | " << e.what() << "]\n";
+            return UPDATE_FALSE;
+        }
+    }
+
+    MapPool *newMapPool = new MapPool();
+    for (size_t i = 0; i < nodes.size(); i++) {
+        SlotRange slots = { nodes[i].slotStart, nodes[i].slotEnd };
+        if (kept[i] == NULL) {
+            InsertNode(newMapPool, slots, fresh[i]);
+            continue;
+        }
+        // the old entry gives up its connections, ClearPool() skips them
+        InsertNode(newMapPool, slots, *kept[i]);
+        kept[i]->context = NULL;
+        kept[i]->stripes.clear();
+    }
+
+    MapPool *oldMapPool = _mapPool;
+    _mapPool = newMapPool;
+    ClearPool(oldMapPool);
+    delete oldMapPool;
+    _topologyVersion = version;
+    return UPDATE_TRUE;
+}
+
+template<typename CONTEXT>
+auto ClusterPool<CONTEXT>::FindReusableNode(const TopologyNode &node, 
+                                            const std::vector<ClusterNodeData *> &taken) 
+        -> ClusterNodeData *
+{
+    typename MapPool::iterator it;
+    for (it = _mapPool->begin(); it != _mapPool->end(); it++) {
+        ClusterNodeData *nodeData = &(it->second);
+        if (strncmp(nodeData->id, node.id, 41) || 
+                strncmp(nodeData->ip, node.ip, sizeof(nodeData->ip)) || 
+                nodeData->port != node.port) {
+            continue;
+        }
+        if (std::find(taken.begin(), taken.end(), nodeData) != taken.end()) {
+            continue;
+        }
+        // stripe settings changed or a connection failed, reconnect the node
+        if (nodeData->stripes.size() + 1 != _stripes * _lanes || 
+                nodeData->laneCount != _lanes || 
+                nodeData->context == NULL || nodeData->context->err) {
+            continue;
+        }
+        bool healthy = true;
+        for (size_t i = 0; i < nodeData->stripes.size(); i++) {
+            if (nodeData->stripes[i] == NULL || nodeData->stripes[i]->err) {
+                healthy = false;
+                break;
             }
-            
-            nodeData->context = NULL;
         }
-        count++;
+        if (healthy) {
+            return nodeData;
+        }
+    }
+    return NULL;
+}
+
+template<typename CONTEXT>
+void ClusterPool<CONTEXT>::ClearPool(MapPool *mapPool)
+{
+    typename MapPool::iterator it;
+    for (it = mapPool->begin(); it != mapPool->end(); it++) {
+        ClearNode(it->second);
     }
     mapPool->clear();
 }
 
+template<typename CONTEXT>
+void ClusterPool<CONTEXT>::ClearNode(ClusterNodeData &nodeData)
+{
+    // freeing may run the disconnect callback, which clears the pointer too
+    for (size_t i = 0; i < nodeData.stripes.size(); i++) {
+        FreeContext(nodeData.stripes[i]);
+        nodeData.stripes[i] = NULL;
+    }
+    nodeData.stripes.clear();
+
+    FreeContext(nodeData.context);
+    nodeData.context = NULL;
+}
+
+template<typename CONTEXT>
+void ClusterPool<CONTEXT>::FreeContext(Context *context)
+{
+    if (context == NULL) {
+        return;
+    }
+    try {
+        Policy::Free(context);
+    }
+    catch(const std::exception& e) {
+        std::cerr << "[ClearPool() | free() | " << e.what() << "]\n";
+    }
+}
+
 template<typename CONTEXT>
 void ClusterPool<CONTEXT>::PrintPool()
 {
@@ -296,6 +445,7 @@ void ClusterPool<CONTEXT>::PrintPool()
                   << "port | " << nodeData->port << " | "
                   << "ip | " << nodeData->ip << " | "
                   << "context | " << nodeData->context << " | "
+                  << "stripes | " << nodeData->stripes.size() + 1 << " | "
                   << "connection | " << nodeData->connected << " | "
                   << "slot | " << it->first.first << " " << it->first.second 
                   << "]\n";
@@ -5,10 +5,14 @@
 #include <string.h>
 #include <string>
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <stdarg.h>
 
 #include "slothash.h"
 #include "clustertypelist.h"
+#include "contextpolicy.h"
+#include "sharedtopology.h"
 #include "cluster.h"
 #include "asynccluster.h"
 
@@ -28,11 +32,9 @@ public:
     typedef typename ClusterTypeList<CONTEXT>::ClusterNode     ClusterNode;
     typedef typename ClusterTypeList<CONTEXT>::SlotCmp         SlotCmp;
     typedef typename ClusterTypeList<CONTEXT>::MapPool         MapPool;
-    typedef typename ClusterTypeList<CONTEXT>::ConnectFn       ConnectFn;
-    typedef typename ClusterTypeList<CONTEXT>::FreeConnectFn   FreeConnectFn;
+    typedef ContextPolicy<CONTEXT>                             Policy;
 public:
-    ClusterPool(int connect_timeout, int command_timeout, 
-                ConnectFn *connectFn, FreeConnectFn *freeConnectFn);
+    ClusterPool(int connect_timeout, int command_timeout);
     ~ClusterPool();
 
     ClusterPool(const ClusterPool &) = delete;
@@ -40,6 +42,8 @@ public:
 
     UpdatePoolType InitPool(const char *ip, int port);
     bool InitNode(ClusterNodeData &nodeContext, const char *ip, int port, const char *id);
+    Context *Connect(const char *ip, int port);
+    static void Free(Context *context) { Policy::Free(context); }
     static bool InsertNode(MapPool *mapPool, SlotRange slots, ClusterNodeData node);
     ClusterNode *GetNodeBySlot(Slot index);
     ClusterNode *GetNodeByKey(const std::string *key);
@@ -47,6 +51,14 @@ public:
     ClusterNode *GetNodeByID(const char *id);
 
     UpdatePoolType UpdatePool();
+    bool ShareTopology(const char *ip, int port);
+    // connections opened per node from the next InitPool() on, at least one
+    void SetStripes(uint32_t count) { _stripes = count > 0 ? count : 1; }
+    uint32_t GetStripes() { return _stripes; }
+    // every lane gets its own stripes of each node
+    void SetLanes(uint32_t count) { _lanes = count > 0 ? count : 1; }
+    uint32_t GetLanes() { return _lanes; }
+    bool IsStale() { return _topology && _topology->GetVersion() != _topologyVersion; }
     bool IsSamePool(const redisReply *reply);
     void ClearPool(MapPool *mapPool);
     void PrintPool();
@@ -55,12 +67,21 @@ public:
     MapPool *GetMapPool() { return _mapPool; }
     int GetConnectTimeout() { return _connect_timeout; }
     int GetCommandTimeout() { return _command_timeout; }
+    SharedTopology *GetTopology() { return _topology; }
 public:
     static const uint32_t FAILUREMAXCOUNT = 1;
+private:
+    UpdatePoolType InitPoolFromTopology();
+    ClusterNodeData *FindReusableNode(const TopologyNode &node, 
+                                      const std::vector<ClusterNodeData *> &taken);
+    void ClearNode(ClusterNodeData &nodeData);
+    void FreeContext(Context *context);
 private:
     MapPool *_mapPool;
-    ConnectFn *_connectFn;
-    FreeConnectFn *_freeConnectFn;
+    SharedTopology *_topology;
+    uint64_t _topologyVersion;
+    uint32_t _stripes;
+    uint32_t _lanes;
     int _connect_timeout;
     int _command_timeout;
 };
@@ -0,0 +1,202 @@
+#pragma once
+#include <hiredis.h>
+
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <new>
+
+#include "replyarena.h"
+
+#define COMPLETION_HANDLER_SIZE 48
+
+namespace RedisClusterAPI
+{
+
+class CompletionHandler;
+
+// callables taking the reply or taking over the retained reply, other than a
+// CompletionHandler itself
+template<typename F>
+using EnableIfHandler = typename std::enable_if<
+        (std::is_invocable<typename std::decay<F>::type &, redisReply *>::value ||
+         std::is_invocable<typename std::decay<F>::type &, RetainedReply *>::value) &&
+        !std::is_same<typename std::decay<F>::type, CompletionHandler>::value>::type;
+
+// Move-only type-erased completion of one command, called once with the
+// reply (NULL if the command failed), which is only valid during the call.
+// A callable taking a RetainedReply * instead owns the reply it is given,
+// which is how a reply leaves the handler without RetainReply().
+//   Callables up to COMPLETION_HANDLER_SIZE bytes that move without throwing
+// are stored inline, in the request object that carries the handler, larger
+// ones are moved to the heap.
+class CompletionHandler
+{
+public:
+    CompletionHandler() : _ops(NULL) {}
+    template<typename F, typename = EnableIfHandler<F>>
+    CompletionHandler(F &&fn)
+    {
+        typedef typename std::decay<F>::type Fn;
+        if constexpr (sizeof(Fn) <= COMPLETION_HANDLER_SIZE &&
+                alignof(Fn) <= alignof(std::max_align_t) &&
+                std::is_nothrow_move_constructible<Fn>::value) {
+            new (_storage) Fn(std::forward<F>(fn));
+            _ops = &InlineOps<Fn>::ops;
+        } else {
+            *(Fn **)_storage = new Fn(std::forward<F>(fn));
+            _ops = &HeapOps<Fn>::ops;
+        }
+    }
+    CompletionHandler(CompletionHandler &&other) : _ops(other._ops)
+    {
+        if (_ops) {
+            _ops->move(other._storage, _storage);
+            other._ops = NULL;
+        }
+    }
+    CompletionHandler& operator=(CompletionHandler &&other)
+    {
+        if (this != &other) {
+            Reset();
+            _ops = other._ops;
+            if (_ops) {
+                _ops->move(other._storage, _storage);
+                other._ops = NULL;
+            }
+        }
+        return *this;
+    }
+    ~CompletionHandler() { Reset(); }
+    CompletionHandler(const CompletionHandler &) = delete;
+    CompletionHandler& operator=(const CompletionHandler &) = delete;
+
+    // a retaining handler gets a copy of the reply
+    void operator()(redisReply *reply) { _ops->invoke(_storage, reply); }
+    // takes 'reply', a plain handler is called with it and it is deleted
+    void Take(RetainedReply *reply) { _ops->take(_storage, reply); }
+    explicit operator bool() const { return _ops != NULL; }
+    bool is_inline() const { return _ops && _ops->isInline; }
+    bool is_retaining() const { return _ops && _ops->isRetaining; }
+    void Reset()
+    {
+        if (_ops) {
+            _ops->destroy(_storage);
+            _ops = NULL;
+        }
+    }
+private:
+    struct Ops {
+        void (*invoke)(void *storage, redisReply *reply);
+        void (*take)(void *storage, RetainedReply *reply);
+        void (*move)(void *from, void *to);   // 'from' is left destroyed
+        void (*destroy)(void *storage);
+        bool isInline;
+        bool isRetaining;
+    };
+
+    template<typename Fn>
+    struct Calls {
+        static constexpr bool retaining = !std::is_invocable<Fn &, redisReply *>::value;
+        static void Invoke(Fn &fn, redisReply *reply)
+        {
+            if constexpr (retaining) {
+                fn(reply ? ReplyArena::Copy(reply) : NULL);
+            } else {
+                fn(reply);
+            }
+        }
+        static void Take(Fn &fn, RetainedReply *reply)
+        {
+            if constexpr (retaining) {
+                fn(reply);
+            } else {
+                fn(reply ? reply->GetReply() : NULL);
+                delete reply;
+            }
+        }
+    };
+
+    template<typename Fn>
+    struct InlineOps {
+        static void Invoke(void *storage, redisReply *reply) 
+        { 
+            Calls<Fn>::Invoke(*(Fn *)storage, reply); 
+        }
+        static void Take(void *storage, RetainedReply *reply) 
+        { 
+            Calls<Fn>::Take(*(Fn *)storage, reply); 
+        }
+        static void Move(void *from, void *to)
+        {
+            new (to) Fn(std::move(*(Fn *)from));
+            ((Fn *)from)->~Fn();
+        }
+        static void Destroy(void *storage) { ((Fn *)storage)->~Fn(); }
+        static constexpr Ops ops = { Invoke, Take, Move, Destroy, true, 
+                                     Calls<Fn>::retaining };
+    };
+
+    template<typename Fn>
+    struct HeapOps {
+        static void Invoke(void *storage, redisReply *reply) 
+        { 
+            Calls<Fn>::Invoke(**(Fn **)storage, reply); 
+        }
+        static void Take(void *storage, RetainedReply *reply) 
+        { 
+            Calls<Fn>::Take(**(Fn **)storage, reply); 
+        }
+        static void Move(void *from, void *to) { *(Fn **)to = *(Fn **)from; }
+        static void Destroy(void *storage) { delete *(Fn **)storage; }
+        static constexpr Ops ops = { Invoke, Take, Move, Destroy, false, 
+                                     Calls<Fn>::retaining };
+    };
+private:
+    alignas(std::max_align_t) unsigned char _storage[COMPLETION_HANDLER_SIZE];
+    const Ops *_ops;
+};
+
+// Reply of a completed command, NULL if the command failed. Owns the reply.
+class CommandResult
+{
+public:
+    CommandResult() : _retained(NULL) {}
+    explicit CommandResult(RetainedReply *retained) : _retained(retained) {}
+    CommandResult(CommandResult &&other) : _retained(other._retained)
+    {
+        other._retained = NULL;
+    }
+    CommandResult& operator=(CommandResult &&other)
+    {
+        if (this != &other) {
+            delete _retained;
+            _retained = other._retained;
+            other._retained = NULL;
+        }
+        return *this;
+    }
+    ~CommandResult() { delete _retained; }
+    CommandResult(const CommandResult &) = delete;
+    CommandResult& operator=(const CommandResult &) = delete;
+
+    redisReply *GetReply() const { return _retained ? _retained->GetReply() : NULL; }
+    bool is_ok() const
+    {
+        return GetReply() && GetReply()->type != REDIS_REPLY_ERROR;
+    }
+    bool is_nil() const { return GetReply() && GetReply()->type == REDIS_REPLY_NIL; }
+    std::string_view GetString() const
+    {
+        redisReply *reply = GetReply();
+        if (reply == NULL || reply->str == NULL) {
+            return std::string_view();
+        }
+        return std::string_view(reply->str, reply->len);
+    }
+private:
+    RetainedReply *_retained;
+};
+
+} // RedisClusterAPI
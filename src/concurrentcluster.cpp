@@ -0,0 +1,373 @@
+#include "concurrentcluster.h"
+#include "argvcommand.h"
+#include "respreader.h"
+#include "cluster.h"
+
+#include <iostream>
+
+namespace RedisClusterAPI
+{
+
+ConcurrentCluster::ConcurrentCluster(const char *ip,
+                                     int port,
+                                     int maxConnections,
+                                     int connect_timeout,
+                                     int command_timeout,
+                                     bool debug)
+    : _topology(NULL), _topologyVersion(0), _refreshCount(0), _port(port), 
+      _maxConnections(maxConnections), _connect_timeout(connect_timeout), 
+      _command_timeout(command_timeout), _debug(debug), _respReader(false), 
+      _sharedTopology(false)
+{
+    memset(_ip, 0, sizeof(_ip));
+    strncpy(_ip, ip, sizeof(_ip) - 1);
+    _nodes = new NodeMap();
+    _masters = new std::vector<TopologyNode>();
+    _retired = new std::vector<Retired>();
+
+    SlotTable *table = new SlotTable();
+    table->version = 0;
+    table->topologyVersion = 0;
+    std::fill(table->slots, table->slots + SLOTCOUNT, (NodeConnections *)NULL);
+    _table.store(table);
+}
+
+// no thread may be inside a command
+ConcurrentCluster::~ConcurrentCluster()
+{
+    for (NodeMap::iterator it = _nodes->begin(); it != _nodes->end(); it++) {
+        delete it->second;
+    }
+    delete _nodes;
+    _nodes = NULL;
+    delete _table.exchange(NULL);
+    for (size_t i = 0; i < _retired->size(); i++) {
+        delete (*_retired)[i].table;
+    }
+    delete _retired;
+    _retired = NULL;
+    delete _masters;
+    _masters = NULL;
+    SharedTopology::Release(_topology);
+    _topology = NULL;
+}
+
+bool ConcurrentCluster::Connect()
+{
+    std::lock_guard<std::mutex> lock(_refreshLock);
+    if (_sharedTopology && _topology == NULL) {
+        _topology = SharedTopology::Acquire(_ip, _port, _connect_timeout, _command_timeout);
+    }
+    std::vector<TopologyNode> nodes;
+    if (FetchTopology(nodes) == UPDATE_FALSE) {
+        return false;
+    }
+    return BuildSlots(nodes);
+}
+
+bool ConcurrentCluster::Set(std::string_view key, std::string_view val)
+{
+    std::string_view argv[3] = { "SET", key, val };
+    redisReply *reply = CommandArgv(key, 3, argv, NULL);
+    if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
+        freeReplyObject(reply);
+        return false;
+    }
+    freeReplyObject(reply);
+    return true;
+}
+
+bool ConcurrentCluster::Get(std::string_view key, std::string &output)
+{
+    std::string_view argv[2] = { "GET", key };
+    redisReply *reply = CommandArgv(key, 2, argv, NULL);
+    if (reply == NULL || reply->type != REDIS_REPLY_STRING) {
+        freeReplyObject(reply);
+        return false;
+    }
+    output.assign(reply->str, reply->len);
+    freeReplyObject(reply);
+    return true;
+}
+
+bool ConcurrentCluster::Get(std::string_view key, ValueCallback *callback, void *privdata)
+{
+    std::string_view argv[2] = { "GET", key };
+    ValueSink sink(callback, privdata);
+    redisReply *reply = CommandArgv(key, 2, argv, &sink);
+    if (reply == NULL || reply->type != REDIS_REPLY_STRING) {
+        freeReplyObject(reply);
+        return false;
+    }
+    freeReplyObject(reply);
+    return sink.IsDelivered();
+}
+
+redisReply *ConcurrentCluster::CommandArgv(std::string_view key,
+                                           int argc,
+                                           const std::string_view *argv)
+{
+    return CommandArgv(key, argc, argv, NULL);
+}
+
+void ConcurrentCluster::GetStats(std::vector<NodeConnectionStats> &stats)
+{
+    std::lock_guard<std::mutex> lock(_nodesLock);
+    stats.resize(_nodes->size());
+    size_t i = 0;
+    for (NodeMap::iterator it = _nodes->begin(); it != _nodes->end(); it++) {
+        it->second->GetStats(stats[i++]);
+    }
+}
+
+void ConcurrentCluster::PrintStats()
+{
+    std::vector<NodeConnectionStats> stats;
+    GetStats(stats);
+    for (size_t i = 0; i < stats.size(); i++) {
+        NodeConnectionStats &s = stats[i];
+        std::cout << "\t[node | " << s.ip << ":" << s.port
+                  << " | connections: " << s.created << "/" << s.maxConnections
+                  << " | checkouts: " << s.checkouts
+                  << " | waits: " << s.waits
+                  << " | wait timeouts: " << s.waitTimeouts
+                  << " | average wait: " << (s.waits ? s.waitNsec / s.waits / 1000 : 0) << "us"
+                  << " | max wait: " << s.maxWaitNsec / 1000 << "us"
+                  << " | connect failures: " << s.connectFailures << "]\n";
+    }
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+redisReply *ConcurrentCluster::CommandArgv(std::string_view key,
+                                           int argc,
+                                           const std::string_view *argv,
+                                           ValueSink *sink)
+{
+    ArgvCommand argvCmd(argc, argv);
+    Slot index = SlotHash::slotByKey(key.data(), key.length());
+    bool updated = false;
+
+    while (true) {
+        uint64_t version;
+        bool stale;
+        NodeConnections *node = GetNodeBySlot(index, &version, &stale);
+        // another client refreshed the shared topology
+        if (stale && Refresh(version)) {
+            continue;
+        }
+        redisContext *context = node ? node->Checkout() : NULL;
+        redisReply *reply = NULL;
+
+        if (context) {
+            bool sent = Cluster::SendArgvCommand(context, &argvCmd) &&
+                        GetReply(context, &reply, sink) == REDIS_OK;
+            node->Return(context, sent == false);
+            if (sent) {
+                const char *ip;
+                int port;
+                int state = Cluster::processReply(reply, ip, port);
+                if (state == ASK) {
+                    redisReply *asked = Ask(ip, port, &argvCmd, sink);
+                    freeReplyObject(reply);
+                    return asked;
+                }
+                if (state != MOVED || updated) {
+                    return reply;
+                }
+                // the slot moved, refresh and retry once
+                freeReplyObject(reply);
+                reply = NULL;
+            }
+        }
+
+        // if updated the pool, still fails to send command
+        if (updated) {
+            break;
+        }
+        // new master hasn't been elected yet, fails to send command
+        if (Refresh(version) == false) {
+            break;
+        }
+
+        if (_debug) {
+            printf("[POOL UPDATED]\n");
+        }
+
+        // new master has been elected, try to send the command again
+        updated = true;
+    }
+    return NULL;
+}
+
+//   The slot is being migrated, the command goes once to the importing node
+// ('ip' points into the ASK error, it must outlive this call), on one of its
+// connections with ASKING in front of it.
+redisReply *ConcurrentCluster::Ask(const char *ip, 
+                                   int port, 
+                                   ArgvCommand *argv, 
+                                   ValueSink *sink)
+{
+    NodeConnections *node = GetNode(ip, port);
+    redisContext *context = node->Checkout();
+    if (context == NULL) {
+        return NULL;
+    }
+
+    redisReply *reply = NULL;
+    bool sent = redisAppendCommand(context, "ASKING") == REDIS_OK &&
+                Cluster::SendArgvCommand(context, argv) &&
+                GetReply(context, &reply, NULL) == REDIS_OK;
+    if (sent) {
+        freeReplyObject(reply);
+        reply = NULL;
+        sent = GetReply(context, &reply, sink) == REDIS_OK;
+    }
+    node->Return(context, sent == false);
+    return sent ? reply : NULL;
+}
+
+// the node stays valid once the table it was read from is reclaimed
+NodeConnections *ConcurrentCluster::GetNodeBySlot(Slot index, uint64_t *version, bool *stale)
+{
+    EpochGuard guard(&_retireLock);
+    const SlotTable *table = _table.load();
+    *version = table->version;
+    *stale = _topology && _topology->GetVersion() != table->topologyVersion;
+    return table->slots[index];
+}
+
+NodeConnections *ConcurrentCluster::GetNode(const char *ip, int port)
+{
+    std::string name = std::string(ip) + ":" + std::to_string(port);
+    std::lock_guard<std::mutex> lock(_nodesLock);
+    NodeMap::iterator found = _nodes->find(name);
+    if (found == _nodes->end()) {
+        NodeConnections *node = new NodeConnections(ip, port, _maxConnections,
+                                                    _connect_timeout,
+                                                    _command_timeout);
+        found = _nodes->insert(NodeMap::value_type(name, node)).first;
+    }
+    return found->second;
+}
+
+// only the first thread failing on 'version' refreshes, a newer table means
+// another thread already did
+bool ConcurrentCluster::Refresh(uint64_t version)
+{
+    std::lock_guard<std::mutex> lock(_refreshLock);
+    // only the refreshing thread replaces the table
+    if (_table.load()->version != version) {
+        return true;
+    }
+    std::vector<TopologyNode> nodes;
+    UpdatePoolType res = FetchTopology(nodes);
+    if (res == UPDATE_FALSE || res == UPDATE_UNCHANGED) {
+        return false;
+    }
+    _refreshCount.fetch_add(1, std::memory_order_relaxed);
+    return BuildSlots(nodes);
+}
+
+//   Called under _refreshLock. Only CLUSTER SLOTS is run, over a connection
+// closed right after: the node connections are opened on demand by their 
+// NodeConnections.
+UpdatePoolType ConcurrentCluster::FetchTopology(std::vector<TopologyNode> &nodes)
+{
+    // another client may have published a newer topology already
+    if (_topology) {
+        if (_topology->GetVersion() == _topologyVersion) {
+            UpdatePoolType res = _topology->Refresh(_topologyVersion);
+            if (res != UPDATE_TRUE) {
+                return res;
+            }
+        }
+        TopologyReader reader(_topology);
+        const TopologySnapshot *snapshot = reader.Get();
+        if (snapshot == NULL) {
+            return UPDATE_FALSE;
+        }
+        nodes = snapshot->nodes;
+        _topologyVersion = snapshot->version;
+        return UPDATE_TRUE;
+    }
+
+    // known masters first, the seed last
+    bool fetched = false;
+    for (size_t i = 0; i < _masters->size() && fetched == false; i++) {
+        const TopologyNode &node = (*_masters)[i];
+        fetched = SharedTopology::FetchSlots(node.ip, node.port, _connect_timeout, 
+                                             _command_timeout, nodes);
+    }
+    if (fetched == false) {
+        fetched = SharedTopology::FetchSlots(_ip, _port, _connect_timeout, 
+                                             _command_timeout, nodes);
+    }
+    if (fetched == false) {
+        return UPDATE_FALSE;
+    }
+    if (_masters->empty() == false && SharedTopology::IsSame(*_masters, nodes)) {
+        return UPDATE_UNCHANGED;
+    }
+    return UPDATE_TRUE;
+}
+
+// called under _refreshLock, publishes a new table
+bool ConcurrentCluster::BuildSlots(const std::vector<TopologyNode> &nodes)
+{
+    SlotTable *table = new SlotTable();
+    std::fill(table->slots, table->slots + SLOTCOUNT, (NodeConnections *)NULL);
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const TopologyNode &master = nodes[i];
+        NodeConnections *node = GetNode(master.ip, master.port);
+        for (Slot s = master.slotStart; s <= master.slotEnd && s < SLOTCOUNT; s++) {
+            table->slots[s] = node;
+        }
+    }
+    *_masters = nodes;
+
+    std::lock_guard<std::recursive_mutex> retireLock(_retireLock);
+    SlotTable *old = _table.load();
+    table->version = old->version + 1;
+    table->topologyVersion = _topologyVersion;
+    _table.store(table);
+    // readers from this epoch on cannot see 'old'
+    _retired->push_back({ old, EpochGuard::Retire() });
+    Reclaim();
+    return true;
+}
+
+// called under _retireLock
+void ConcurrentCluster::Reclaim()
+{
+    uint64_t oldest = EpochGuard::GetOldestEpoch();
+    size_t kept = 0;
+    for (size_t i = 0; i < _retired->size(); i++) {
+        if ((*_retired)[i].epoch < oldest) {
+            delete (*_retired)[i].table;
+        } else {
+            (*_retired)[kept++] = (*_retired)[i];
+        }
+    }
+    _retired->resize(kept);
+}
+
+int ConcurrentCluster::GetReply(redisContext *context, redisReply **reply, ValueSink *sink)
+{
+    int res;
+    if (sink) {
+        sink->Attach(context);
+    }
+    if (_respReader) {
+        res = RespReader::GetReply(context, (void **)reply);
+    } else {
+        res = redisGetReply(context, (void **)reply);
+    }
+    if (sink) {
+        sink->Detach(context);
+    }
+    return res;
+}
+
+} // RedisClusterAPI
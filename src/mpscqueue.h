@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <utility>
+
+namespace RedisClusterAPI
+{
+
+// Bounded lock-free multi-producer single-consumer queue.
+//   Ring of cells with a sequence number each (Vyukov's bounded queue): a
+// producer claims a position with a compare-exchange on the tail and
+// publishes the cell by bumping its sequence, the consumer owns the head.
+// Push() fails when the ring is full. Pop() may miss a cell whose producer
+// has claimed it but not published it yet, that producer signals afterwards.
+template<typename T>
+class MpscQueue
+{
+public:
+    explicit MpscQueue(size_t capacity)
+        : _head(0)
+    {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _mask = size - 1;
+        _buffer = new Cell[size];
+        for (size_t i = 0; i < size; i++) {
+            _buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        _tail.store(0, std::memory_order_relaxed);
+    }
+
+    ~MpscQueue() { delete[] _buffer; }
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue& operator=(const MpscQueue &) = delete;
+
+    bool Push(T &&value)
+    {
+        Cell *cell;
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &_buffer[pos & _mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer thread only
+    bool Pop(T &value)
+    {
+        Cell *cell = &_buffer[_head & _mask];
+        if (cell->sequence.load(std::memory_order_acquire) != _head + 1) {
+            return false;
+        }
+        value = std::move(cell->data);
+        cell->sequence.store(_head + _mask + 1, std::memory_order_release);
+        _head++;
+        return true;
+    }
+
+    size_t GetCapacity() { return _mask + 1; }
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+private:
+    Cell *_buffer;
+    size_t _mask;
+    alignas(64) std::atomic<size_t> _tail;
+    alignas(64) size_t _head;
+};
+
+} // RedisClusterAPI
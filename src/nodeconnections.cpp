@@ -0,0 +1,195 @@
+#include "nodeconnections.h"
+
+#include <chrono>
+#include <thread>
+#include <functional>
+
+namespace RedisClusterAPI
+{
+
+NodeConnections::NodeConnections(const char *ip,
+                                 int port,
+                                 int maxConnections,
+                                 int connect_timeout,
+                                 int command_timeout)
+    : _created(0), _waiters(0), _checkouts(0), _waits(0), _waitTimeouts(0),
+      _waitNsec(0), _maxWaitNsec(0), _connectFailures(0), _ip(ip), _port(port),
+      _maxConnections(maxConnections > 0 ? maxConnections : 1),
+      _connect_timeout(connect_timeout), _command_timeout(command_timeout)
+{
+    _idle = new std::atomic<redisContext *>[_maxConnections];
+    for (int i = 0; i < _maxConnections; i++) {
+        _idle[i].store(NULL, std::memory_order_relaxed);
+    }
+}
+
+// every connection must have been returned
+NodeConnections::~NodeConnections()
+{
+    for (int i = 0; i < _maxConnections; i++) {
+        redisContext *context = _idle[i].exchange(NULL);
+        if (context) {
+            ContextPolicy<redisContext>::Free(context);
+        }
+    }
+    delete[] _idle;
+    _idle = NULL;
+}
+
+redisContext *NodeConnections::Checkout()
+{
+    _checkouts.fetch_add(1, std::memory_order_relaxed);
+
+    redisContext *context = TryTake();
+    if (context) {
+        return context;
+    }
+    bool capped = false;
+    context = TryConnect(&capped);
+    if (context || capped == false) {
+        return context;
+    }
+
+    // at the cap: wait for a Return()
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(_command_timeout);
+    {
+        std::unique_lock<std::mutex> lock(_waitLock);
+        // seq_cst, pairs with the load in Wakeup()
+        _waiters.fetch_add(1);
+        while (true) {
+            // a connection closed meanwhile frees a place, never connect
+            // under the lock
+            lock.unlock();
+            context = TryConnect(&capped);
+            lock.lock();
+            if (context || capped == false) {
+                break;
+            }
+            context = TryTake();
+            if (context) {
+                break;
+            }
+            if (_command_timeout <= 0) {
+                _waitCond.wait(lock);
+            } else if (_waitCond.wait_until(lock, deadline) == std::cv_status::timeout) {
+                context = TryTake();
+                if (context == NULL) {
+                    _waitTimeouts.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+            }
+        }
+        _waiters.fetch_sub(1);
+    }
+
+    uint64_t nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count();
+    _waits.fetch_add(1, std::memory_order_relaxed);
+    _waitNsec.fetch_add(nsec, std::memory_order_relaxed);
+    uint64_t max = _maxWaitNsec.load(std::memory_order_relaxed);
+    while (nsec > max &&
+           !_maxWaitNsec.compare_exchange_weak(max, nsec, std::memory_order_relaxed)) {
+    }
+    return context;
+}
+
+// a broken connection (I/O or protocol error) is closed, which frees its
+// place under the cap
+void NodeConnections::Return(redisContext *context, bool broken)
+{
+    if (context == NULL) {
+        return;
+    }
+    if (broken || context->err) {
+        ContextPolicy<redisContext>::Free(context);
+        _created.fetch_sub(1);
+        Wakeup();
+        return;
+    }
+
+    // _created never exceeds the slot count, an empty slot always exists
+    size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+    while (true) {
+        for (int i = 0; i < _maxConnections; i++) {
+            std::atomic<redisContext *> &slot = _idle[(start + i) % _maxConnections];
+            redisContext *empty = NULL;
+            if (slot.load(std::memory_order_relaxed) == NULL &&
+                slot.compare_exchange_strong(empty, context)) {
+                Wakeup();
+                return;
+            }
+        }
+    }
+}
+
+void NodeConnections::GetStats(NodeConnectionStats &stats)
+{
+    stats.ip = _ip;
+    stats.port = _port;
+    stats.created = _created.load(std::memory_order_relaxed);
+    stats.maxConnections = _maxConnections;
+    stats.checkouts = _checkouts.load(std::memory_order_relaxed);
+    stats.waits = _waits.load(std::memory_order_relaxed);
+    stats.waitTimeouts = _waitTimeouts.load(std::memory_order_relaxed);
+    stats.waitNsec = _waitNsec.load(std::memory_order_relaxed);
+    stats.maxWaitNsec = _maxWaitNsec.load(std::memory_order_relaxed);
+    stats.connectFailures = _connectFailures.load(std::memory_order_relaxed);
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+// threads start scanning at different slots to spread the contention
+redisContext *NodeConnections::TryTake()
+{
+    size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+    for (int i = 0; i < _maxConnections; i++) {
+        std::atomic<redisContext *> &slot = _idle[(start + i) % _maxConnections];
+        if (slot.load(std::memory_order_relaxed) == NULL) {
+            continue;
+        }
+        redisContext *context = slot.exchange(NULL, std::memory_order_acquire);
+        if (context) {
+            return context;
+        }
+    }
+    return NULL;
+}
+
+// reserves a place under the cap before connecting, sets 'capped' if there
+// is none
+redisContext *NodeConnections::TryConnect(bool *capped)
+{
+    int created = _created.load(std::memory_order_relaxed);
+    do {
+        if (created >= _maxConnections) {
+            *capped = true;
+            return NULL;
+        }
+    } while (!_created.compare_exchange_weak(created, created + 1));
+
+    *capped = false;
+    ContextOptions opts(_ip.c_str(), _port, _connect_timeout, _command_timeout);
+    redisContext *context = ContextPolicy<redisContext>::Connect(opts);
+    if (context && context->err == 0) {
+        return context;
+    }
+
+    if (context) {
+        ContextPolicy<redisContext>::Free(context);
+    }
+    _connectFailures.fetch_add(1, std::memory_order_relaxed);
+    _created.fetch_sub(1);
+    Wakeup();
+    return NULL;
+}
+
+void NodeConnections::Wakeup()
+{
+    if (_waiters.load() > 0) {
+        std::lock_guard<std::mutex> lock(_waitLock);
+        _waitCond.notify_one();
+    }
+}
+
+} // RedisClusterAPI
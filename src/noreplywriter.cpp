@@ -0,0 +1,292 @@
+#include "noreplywriter.h"
+
+namespace RedisClusterAPI
+{
+
+#define REDIS_COMMAND_REPLY_OFF "*3\r\n$6\r\nCLIENT\r\n$5\r\nREPLY\r\n$3\r\nOFF\r\n"
+#define REDIS_COMMAND_REPLY_ON  "*3\r\n$6\r\nCLIENT\r\n$5\r\nREPLY\r\n$2\r\nON\r\n"
+#define REDIS_COMMAND_PING      "*1\r\n$4\r\nPING\r\n"
+
+NoReplyWriter::NoReplyWriter(AsyncCluster *asyncCluster, 
+                             int checkpoint_interval, 
+                             uint32_t checkpoint_count)
+    : _asyncCluster(asyncCluster), _timer(NULL), 
+      _checkpoint_count(checkpoint_count), _sent(0), _confirmed(0), _lost(0), 
+      _moved(0)
+{
+    _connections = new ConnectionMap();
+
+    if (checkpoint_interval > 0) {
+        timeval tv = { checkpoint_interval / 1000, 
+                       (checkpoint_interval % 1000) * 1000 };
+        _timer = event_new(asyncCluster->GetEvBase(), -1, EV_PERSIST, 
+                           OnCheckpointTimer, this);
+        event_add(_timer, &tv);
+    }
+}
+
+NoReplyWriter::~NoReplyWriter()
+{
+    if (_timer) {
+        event_free(_timer);
+        _timer = NULL;
+    }
+
+    ConnectionMap::iterator it;
+    for (it = _connections->begin(); it != _connections->end(); it++) {
+        NoReplyConnection *conn = it->second;
+        if (conn->context) {
+            // pending checkpoint callbacks are invoked with a NULL reply
+            conn->context->data = NULL;
+            redisAsyncFree(conn->context);
+        }
+        delete conn;
+    }
+    delete _connections;
+    _connections = NULL;
+}
+
+bool NoReplyWriter::Set(std::string_view key, std::string_view val)
+{
+    std::string_view argv[3] = { "SET", key, val };
+    return CommandArgv(key, 3, argv);
+}
+
+bool NoReplyWriter::CommandArgv(std::string_view key, 
+                                int argc, 
+                                const std::string_view *argv)
+{
+    // appended to the output buffer, so every argument is copied right away
+    ArgvCommand argvCmd(argc, argv);
+    char *cmd = argvCmd.Format();
+    if (cmd == NULL) {
+        return false;
+    }
+    return Append(std::string(key), cmd, argvCmd.GetLength());
+}
+
+bool NoReplyWriter::Command(std::string key, const char *format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+
+    char *cmd;
+    int cmdlen = redisvFormatCommand(&cmd, format, ap);
+    va_end(ap);
+    if (cmdlen < 0) {
+        return false;
+    }
+    return Append(key, cmd, cmdlen);
+}
+
+int NoReplyWriter::Checkpoint()
+{
+    int failed = 0;
+    ConnectionMap::iterator it;
+    for (it = _connections->begin(); it != _connections->end(); it++) {
+        if (it->second->context && !Checkpoint(it->second)) {
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+// takes the malloc'ed command
+bool NoReplyWriter::Append(const std::string &key, char *cmd, int cmdlen)
+{
+    NoReplyConnection *conn = GetConnection(key);
+    if (conn == NULL) {
+        free(cmd);
+        return false;
+    }
+
+    //   No callback is registered since no reply is coming back, the command 
+    // goes straight into the output buffer and leaves with the next write.
+    int res = redisAppendFormattedCommand(&conn->context->c, cmd, cmdlen);
+    free(cmd);
+    if (res != REDIS_OK) {
+        return false;
+    }
+    ArmWrite(conn->context);
+
+    conn->sent++;
+    conn->lastKey = key;
+    _sent++;
+    if (_checkpoint_count > 0 && ++conn->sinceCheckpoint >= _checkpoint_count) {
+        Checkpoint(conn);
+    }
+    return true;
+}
+
+auto NoReplyWriter::GetConnection(const std::string &key) -> NoReplyConnection *
+{
+    ClusterNode *node = _asyncCluster->GetPool()->GetNodeByKey(&key);
+    if (node == NULL) {
+        return NULL;
+    }
+
+    ClusterNodeData *nodeData = &(node->second);
+    NoReplyConnection *&conn = (*_connections)[nodeData->id];
+    if (conn == NULL) {
+        conn = new NoReplyConnection();
+        conn->writer = this;
+    }
+    if (conn->context) {
+        return conn;
+    }
+
+    // same timeouts as the connections of the cluster
+    AsyncCluster::AsyncClusterPool *pool = _asyncCluster->GetPool();
+    ContextOptions opts(nodeData->ip, nodeData->port, 
+                        pool->GetConnectTimeout(), pool->GetCommandTimeout());
+    redisAsyncContext *context = ContextPolicy<redisAsyncContext>::Connect(opts);
+    if (context == NULL) {
+        return NULL;
+    }
+    if (context->err) {
+        redisAsyncFree(context);
+        return NULL;
+    }
+
+    context->data = (void *)this;
+    redisLibeventAttach(context, _asyncCluster->GetEvBase());
+    redisAsyncSetConnectCallback(context, OnConnect);
+    redisAsyncSetDisconnectCallback(context, OnDisconnect);
+
+    // the PING arms the connect event, its reply is the last one until the 
+    // next checkpoint
+    if (redisAsyncFormattedCommand(context, NULL, NULL, REDIS_COMMAND_PING, 
+                                   strlen(REDIS_COMMAND_PING)) != REDIS_OK) {
+        context->data = NULL;
+        redisAsyncFree(context);
+        return NULL;
+    }
+    redisAppendFormattedCommand(&context->c, REDIS_COMMAND_REPLY_OFF, 
+                                strlen(REDIS_COMMAND_REPLY_OFF));
+
+    conn->context = context;
+    conn->sinceCheckpoint = 0;
+    conn->lastKey.clear();
+    return conn;
+}
+
+auto NoReplyWriter::GetConnectionByCtx(const redisAsyncContext *context) 
+    -> NoReplyConnection *
+{
+    ConnectionMap::iterator it;
+    for (it = _connections->begin(); it != _connections->end(); it++) {
+        if (it->second->context == context) {
+            return it->second;
+        }
+    }
+    return NULL;
+}
+
+bool NoReplyWriter::Checkpoint(NoReplyConnection *conn)
+{
+    redisAsyncContext *context = conn->context;
+    conn->sinceCheckpoint = 0;
+
+    if (redisAsyncFormattedCommand(context, NULL, NULL, REDIS_COMMAND_REPLY_ON,
+                                   strlen(REDIS_COMMAND_REPLY_ON)) != REDIS_OK) {
+        return false;
+    }
+
+    //   A read of the last written key is answered with MOVED or ASK by a 
+    // node that no longer owns its slot, a PING would not notice
+    CheckpointData *data = new CheckpointData(conn, conn->sent);
+    int res;
+    if (conn->lastKey.empty()) {
+        res = redisAsyncFormattedCommand(context, OnCheckpoint, data, 
+                                         REDIS_COMMAND_PING, 
+                                         strlen(REDIS_COMMAND_PING));
+    } else {
+        res = redisAsyncCommand(context, OnCheckpoint, data, "EXISTS %b", 
+                                conn->lastKey.data(), conn->lastKey.size());
+        conn->lastKey.clear();
+    }
+    if (res != REDIS_OK) {
+        delete data;
+        return false;
+    }
+
+    redisAppendFormattedCommand(&context->c, REDIS_COMMAND_REPLY_OFF, 
+                                strlen(REDIS_COMMAND_REPLY_OFF));
+    return true;
+}
+
+void NoReplyWriter::ArmWrite(redisAsyncContext *context)
+{
+    // same as what hiredis does internally after queueing a command
+    if (context->ev.addWrite) {
+        context->ev.addWrite(context->ev.data);
+    }
+}
+
+void NoReplyWriter::OnCheckpoint(redisAsyncContext *context, 
+                                 void *r, 
+                                 void *privdata)
+{
+    CheckpointData *data = (CheckpointData *)privdata;
+    redisReply *reply = (redisReply *)r;
+
+    if (context->data == NULL || reply == NULL) {
+        delete data;
+        return;
+    }
+
+    NoReplyWriter *writer = data->conn->writer;
+    if (reply->type == REDIS_REPLY_ERROR && (strncmp(reply->str, "MOVED ", 6) == 0 || 
+                                             strncmp(reply->str, "ASK ", 4) == 0)) {
+        // some of the fenced writes may have been rejected the same way
+        writer->_moved++;
+        writer->_lost += data->sent - data->conn->confirmed;
+        data->conn->confirmed = data->sent;
+        if (reply->str[0] == 'M') {
+            writer->_asyncCluster->UpdatePool();
+        }
+    } else if (reply->type != REDIS_REPLY_ERROR) {
+        writer->_confirmed += data->sent - data->conn->confirmed;
+        data->conn->confirmed = data->sent;
+    }
+    delete data;
+}
+
+// a connection that never came up gets no OnDisconnect(), hiredis frees it
+// right after this
+void NoReplyWriter::OnConnect(const redisAsyncContext *context, int status)
+{
+    if (status == REDIS_OK) {
+        return;
+    }
+    OnDisconnect(context, status);
+}
+
+void NoReplyWriter::OnDisconnect(const redisAsyncContext *context, int)
+{
+    if (context->data == NULL) {
+        return;
+    }
+
+    NoReplyWriter *writer = (NoReplyWriter *)context->data;
+    NoReplyConnection *conn = writer->GetConnectionByCtx(context);
+    if (conn == NULL) {
+        return;
+    }
+
+    // everything behind the last confirmed checkpoint is unknown
+    writer->_lost += conn->sent - conn->confirmed;
+    conn->sent = 0;
+    conn->confirmed = 0;
+    conn->context = NULL;
+}
+
+void NoReplyWriter::OnCheckpointTimer(evutil_socket_t, short, void *arg)
+{
+    NoReplyWriter *writer = (NoReplyWriter *)arg;
+    writer->Checkpoint();
+}
+
+} // RedisClusterAPI
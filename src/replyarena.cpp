@@ -0,0 +1,297 @@
+#include "replyarena.h"
+
+namespace RedisClusterAPI
+{
+
+redisReplyObjectFunctions ReplyArena::_functions = {
+    ReplyArena::CreateString,
+    ReplyArena::CreateArray,
+    ReplyArena::CreateInteger,
+    ReplyArena::CreateDouble,
+    ReplyArena::CreateNil,
+    ReplyArena::CreateBool,
+    ReplyArena::FreeObject
+};
+
+ReplyArena::ReplyArena(size_t chunkSize)
+    : _chunks(NULL), _chunkSize(chunkSize), _chunkAllocs(0) {}
+
+ReplyArena::~ReplyArena()
+{
+    while (_chunks) {
+        Chunk *next = _chunks->next;
+        free(_chunks);
+        _chunks = next;
+    }
+}
+
+void *ReplyArena::Allocate(size_t size)
+{
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    if (_chunks == NULL || _chunks->used + size > _chunks->size) {
+        Chunk *chunk = NewChunk(size > _chunkSize ? size : _chunkSize);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->next = _chunks;
+        _chunks = chunk;
+    }
+
+    void *ptr = _chunks->data() + _chunks->used;
+    _chunks->used += size;
+    return ptr;
+}
+
+void ReplyArena::Reset()
+{
+    if (_chunks == NULL) {
+        return;
+    }
+
+    // keep one regular chunk for the next reply
+    Chunk *keep = NULL;
+    while (_chunks) {
+        Chunk *next = _chunks->next;
+        if (keep == NULL && _chunks->size == _chunkSize) {
+            keep = _chunks;
+        } else {
+            free(_chunks);
+        }
+        _chunks = next;
+    }
+
+    if (keep) {
+        keep->next = NULL;
+        keep->used = 0;
+    }
+    _chunks = keep;
+}
+
+RetainedReply *ReplyArena::Retain(redisReply *reply)
+{
+    // already handed over by an earlier Retain()
+    if (_chunks == NULL) {
+        return NULL;
+    }
+
+    // every chunk in use belongs to this very reply, hand them all over
+    RetainedReply *retained = new RetainedReply(reply, _chunks);
+    _chunks = NULL;
+    return retained;
+}
+
+RetainedReply *ReplyArena::Copy(const redisReply *reply)
+{
+    if (reply == NULL) {
+        return NULL;
+    }
+
+    ReplyArena arena;
+    redisReply *copy = arena.CopyReply(reply);
+    if (copy == NULL) {
+        return NULL;
+    }
+    return arena.Retain(copy);
+}
+
+void ReplyArena::Attach(redisContext *context)
+{
+    context->reader->fn = &_functions;
+    context->reader->privdata = (void *)this;
+}
+
+bool ReplyArena::IsAttached(const redisContext *context)
+{
+    return context->reader && context->reader->fn == &_functions;
+}
+
+ReplyArena *ReplyArena::GetArena(const redisContext *context)
+{
+    if (!IsAttached(context)) {
+        return NULL;
+    }
+    return (ReplyArena *)context->reader->privdata;
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+auto ReplyArena::NewChunk(size_t size) -> Chunk *
+{
+    Chunk *chunk = (Chunk *)malloc(sizeof(Chunk) + size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    _chunkAllocs++;
+    return chunk;
+}
+
+redisReply *ReplyArena::CopyReply(const redisReply *reply)
+{
+    redisReply *r = (redisReply *)Allocate(sizeof(redisReply));
+    if (r == NULL) {
+        return NULL;
+    }
+    memcpy(r, reply, sizeof(redisReply));
+
+    if (reply->str) {
+        r->str = (char *)Allocate(reply->len + 1);
+        if (r->str == NULL) {
+            return NULL;
+        }
+        memcpy(r->str, reply->str, reply->len);
+        r->str[reply->len] = '\0';
+    }
+
+    if (reply->element) {
+        r->element = (redisReply **)Allocate(reply->elements * sizeof(redisReply *));
+        if (r->element == NULL) {
+            return NULL;
+        }
+        for (size_t i = 0; i < reply->elements; i++) {
+            r->element[i] = CopyReply(reply->element[i]);
+            if (r->element[i] == NULL) {
+                return NULL;
+            }
+        }
+    }
+    return r;
+}
+
+redisReply *ReplyArena::CreateReply(const redisReadTask *task)
+{
+    ReplyArena *arena = (ReplyArena *)task->privdata;
+    redisReply *r = (redisReply *)arena->Allocate(sizeof(redisReply));
+    if (r == NULL) {
+        return NULL;
+    }
+    memset(r, 0, sizeof(redisReply));
+    r->type = task->type;
+
+    // link to the parent aggregate, same as the default hiredis functions
+    if (task->parent) {
+        redisReply *parent = (redisReply *)task->parent->obj;
+        parent->element[task->idx] = r;
+    }
+    return r;
+}
+
+void *ReplyArena::CreateString(const redisReadTask *task, char *str, size_t len)
+{
+    ReplyArena *arena = (ReplyArena *)task->privdata;
+    redisReply *r = CreateReply(task);
+    if (r == NULL) {
+        return NULL;
+    }
+
+    if (task->type == REDIS_REPLY_VERB) {
+        if (len < 4) {
+            return NULL;
+        }
+        memcpy(r->vtype, str, 3);
+        r->vtype[3] = '\0';
+        str += 4;
+        len -= 4;
+    }
+
+    char *buf = (char *)arena->Allocate(len + 1);
+    if (buf == NULL) {
+        return NULL;
+    }
+    memcpy(buf, str, len);
+    buf[len] = '\0';
+    r->str = buf;
+    r->len = len;
+    return r;
+}
+
+void *ReplyArena::CreateArray(const redisReadTask *task, size_t elements)
+{
+    ReplyArena *arena = (ReplyArena *)task->privdata;
+    redisReply *r = CreateReply(task);
+    if (r == NULL) {
+        return NULL;
+    }
+
+    if (elements > 0) {
+        r->element = (redisReply **)arena->Allocate(elements * sizeof(redisReply *));
+        if (r->element == NULL) {
+            return NULL;
+        }
+        memset(r->element, 0, elements * sizeof(redisReply *));
+    }
+    r->elements = elements;
+    return r;
+}
+
+void *ReplyArena::CreateInteger(const redisReadTask *task, long long value)
+{
+    redisReply *r = CreateReply(task);
+    if (r == NULL) {
+        return NULL;
+    }
+    r->integer = value;
+    return r;
+}
+
+void *ReplyArena::CreateDouble(const redisReadTask *task, 
+                               double value, 
+                               char *str, 
+                               size_t len)
+{
+    ReplyArena *arena = (ReplyArena *)task->privdata;
+    redisReply *r = CreateReply(task);
+    if (r == NULL) {
+        return NULL;
+    }
+
+    r->dval = value;
+    r->str = (char *)arena->Allocate(len + 1);
+    if (r->str == NULL) {
+        return NULL;
+    }
+    memcpy(r->str, str, len);
+    r->str[len] = '\0';
+    r->len = len;
+    return r;
+}
+
+void *ReplyArena::CreateNil(const redisReadTask *task)
+{
+    return CreateReply(task);
+}
+
+void *ReplyArena::CreateBool(const redisReadTask *task, int bval)
+{
+    redisReply *r = CreateReply(task);
+    if (r == NULL) {
+        return NULL;
+    }
+    r->integer = bval != 0;
+    return r;
+}
+
+void ReplyArena::FreeObject(void *)
+{
+    // released all at once by Reset()
+}
+
+//////////////////////////////// RETAINED REPLY ////////////////////////////////
+
+RetainedReply::RetainedReply(redisReply *reply, ReplyArena::Chunk *chunks)
+    : _reply(reply), _chunks(chunks) {}
+
+RetainedReply::~RetainedReply()
+{
+    while (_chunks) {
+        ReplyArena::Chunk *next = _chunks->next;
+        free(_chunks);
+        _chunks = next;
+    }
+    _reply = NULL;
+}
+
+} // RedisClusterAPI
@@ -0,0 +1,814 @@
+#include "respreader.h"
+
+#include <sys/socket.h>
+#include <errno.h>
+#include <math.h>
+#include <limits.h>
+#include <strings.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace RedisClusterAPI
+{
+
+#define RESP_READER_INITIAL_BUFFER (16 * 1024)
+#define RESP_READER_READ_SIZE (16 * 1024)
+#define RESP_READER_DISCARD_SIZE 1024
+
+RespReader::RespReader(redisReplyObjectFunctions *fn, void *privdata)
+    : _buf(NULL), _pos(0), _len(0), _cap(0), _ridx(-1), _reply(NULL), 
+      _err(0), _maxelements((1LL << 32) - 1), 
+      _fn(fn ? fn : DefaultFunctions()), _privdata(privdata)
+{
+    _errstr[0] = '\0';
+    for (int i = 0; i < 9; i++) {
+        _tasks.push_back(new redisReadTask());
+    }
+}
+
+RespReader::~RespReader()
+{
+    if (_reply != NULL && _fn && _fn->freeObject) {
+        _fn->freeObject(_reply);
+    }
+    for (size_t i = 0; i < _tasks.size(); i++) {
+        delete _tasks[i];
+    }
+    free(_buf);
+}
+
+void RespReader::SetFunctions(redisReplyObjectFunctions *fn, void *privdata)
+{
+    _fn = fn ? fn : DefaultFunctions();
+    _privdata = privdata;
+}
+
+redisReplyObjectFunctions *RespReader::DefaultFunctions()
+{
+    // the hiredis defaults are not exported, borrow them from a reader
+    static redisReplyObjectFunctions *functions = [] {
+        redisReader *reader = redisReaderCreate();
+        redisReplyObjectFunctions *fn = reader->fn;
+        redisReaderFree(reader);
+        return fn;
+    }();
+    return functions;
+}
+
+char *RespReader::Reserve(size_t len)
+{
+    if (_err) {
+        return NULL;
+    }
+    if (_pos > 0 && _cap - _len < len) {
+        memmove(_buf, _buf + _pos, _len - _pos);
+        _len -= _pos;
+        _pos = 0;
+    }
+    if (_cap - _len < len) {
+        size_t cap = _cap ? _cap : RESP_READER_INITIAL_BUFFER;
+        while (cap - _len < len) {
+            cap *= 2;
+        }
+        char *buf = (char *)realloc(_buf, cap);
+        if (buf == NULL) {
+            SetError(REDIS_ERR_OOM, "Out of memory");
+            return NULL;
+        }
+        _buf = buf;
+        _cap = cap;
+    }
+    return _buf + _len;
+}
+
+void RespReader::Commit(size_t len)
+{
+    _len += len;
+}
+
+int RespReader::Feed(const char *buf, size_t len)
+{
+    if (_err) {
+        return REDIS_ERR;
+    }
+    if (buf == NULL || len == 0) {
+        return REDIS_OK;
+    }
+    char *dst = Reserve(len);
+    if (dst == NULL) {
+        return REDIS_ERR;
+    }
+    memcpy(dst, buf, len);
+    Commit(len);
+    return REDIS_OK;
+}
+
+int RespReader::GetReply(void **reply)
+{
+    if (reply != NULL) {
+        *reply = NULL;
+    }
+    if (_err) {
+        return REDIS_ERR;
+    }
+    if (_len == 0) {
+        return REDIS_OK;
+    }
+
+    if (_ridx == -1) {
+        redisReadTask *root = _tasks[0];
+        root->type = -1;
+        root->elements = -1;
+        root->idx = -1;
+        root->obj = NULL;
+        root->parent = NULL;
+        root->privdata = _privdata;
+        _ridx = 0;
+    }
+
+    while (_ridx >= 0) {
+        if (ProcessItem() != REDIS_OK) {
+            break;
+        }
+    }
+    if (_err) {
+        return REDIS_ERR;
+    }
+
+    if (_pos == _len) {
+        _pos = _len = 0;
+    } else if (_pos >= RESP_READER_DISCARD_SIZE) {
+        memmove(_buf, _buf + _pos, _len - _pos);
+        _len -= _pos;
+        _pos = 0;
+    }
+
+    if (_ridx == -1) {
+        if (reply != NULL) {
+            *reply = _reply;
+        } else if (_reply != NULL && _fn && _fn->freeObject) {
+            _fn->freeObject(_reply);
+        }
+        _reply = NULL;
+    }
+    return REDIS_OK;
+}
+
+/////////////////////// STATIC FUNCTIONS ///////////////////////////////
+
+const char *RespReader::FindCRLF(const char *p, const char *end)
+{
+    while (p < end) {
+        const char *cr = NULL;
+#if defined(__AVX2__)
+        const __m256i cr32 = _mm256_set1_epi8('\r');
+        while (end - p >= 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)p);
+            uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, cr32));
+            if (mask) {
+                cr = p + __builtin_ctz(mask);
+                break;
+            }
+            p += 32;
+        }
+#endif
+#if defined(__SSE2__)
+        const __m128i cr16 = _mm_set1_epi8('\r');
+        while (cr == NULL && end - p >= 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)p);
+            uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, cr16));
+            if (mask) {
+                cr = p + __builtin_ctz(mask);
+                break;
+            }
+            p += 16;
+        }
+#endif
+        if (cr == NULL) {
+            cr = (const char *)memchr(p, '\r', end - p);
+            if (cr == NULL) {
+                return NULL;
+            }
+        }
+        if (cr + 1 >= end) {
+            return NULL;
+        }
+        if (cr[1] == '\n') {
+            return cr;
+        }
+        p = cr + 1;
+    }
+    return NULL;
+}
+
+// same rules as hiredis string2ll(): no sign but '-', no leading zeros
+int RespReader::ParseInteger(const char *p, size_t len, long long *value)
+{
+    if (len == 0) {
+        return REDIS_ERR;
+    }
+    if (len == 1 && p[0] == '0') {
+        *value = 0;
+        return REDIS_OK;
+    }
+
+    bool negative = false;
+    if (p[0] == '-') {
+        negative = true;
+        p++;
+        len--;
+        if (len == 0) {
+            return REDIS_ERR;
+        }
+    }
+    if (p[0] < '1' || p[0] > '9') {
+        return REDIS_ERR;
+    }
+
+    // lengths and counters have at most 19 digits, overflow is only 
+    // possible from the 20th digit on
+    unsigned long long v = 0;
+    size_t i = 0;
+    size_t fast = len < 19 ? len : 19;
+    for (; i < fast; i++) {
+        unsigned char d = (unsigned char)(p[i] - '0');
+        if (d > 9) {
+            return REDIS_ERR;
+        }
+        v = v * 10 + d;
+    }
+    for (; i < len; i++) {
+        unsigned char d = (unsigned char)(p[i] - '0');
+        if (d > 9 || v > ULLONG_MAX / 10 || v * 10 > ULLONG_MAX - d) {
+            return REDIS_ERR;
+        }
+        v = v * 10 + d;
+    }
+
+    if (negative) {
+        if (v > (unsigned long long)(-(LLONG_MIN + 1)) + 1) {
+            return REDIS_ERR;
+        }
+        *value = -(long long)(v - 1) - 1;
+    } else {
+        if (v > LLONG_MAX) {
+            return REDIS_ERR;
+        }
+        *value = (long long)v;
+    }
+    return REDIS_OK;
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+void RespReader::SetError(int type, const char *str)
+{
+    if (_reply != NULL && _fn && _fn->freeObject) {
+        _fn->freeObject(_reply);
+        _reply = NULL;
+    }
+    _pos = _len = 0;
+    _ridx = -1;
+    _err = type;
+    snprintf(_errstr, sizeof(_errstr), "%s", str);
+}
+
+const char *RespReader::ReadLine(size_t *len)
+{
+    const char *p = _buf + _pos;
+    const char *s = FindCRLF(p, _buf + _len);
+    if (s == NULL) {
+        return NULL;
+    }
+    *len = s - p;
+    _pos += *len + 2;
+    return p;
+}
+
+void RespReader::MoveToNextTask()
+{
+    while (_ridx >= 0) {
+        if (_ridx == 0) {
+            _ridx--;
+            return;
+        }
+        redisReadTask *cur = _tasks[_ridx];
+        redisReadTask *prv = _tasks[_ridx - 1];
+        if (cur->idx == prv->elements - 1) {
+            _ridx--;
+        } else {
+            cur->type = -1;
+            cur->elements = -1;
+            cur->idx++;
+            return;
+        }
+    }
+}
+
+int RespReader::ProcessLineItem(redisReadTask *cur)
+{
+    size_t len;
+    const char *p = ReadLine(&len);
+    if (p == NULL) {
+        return REDIS_ERR;
+    }
+
+    void *obj;
+    if (cur->type == REDIS_REPLY_INTEGER) {
+        long long v;
+        if (ParseInteger(p, len, &v) == REDIS_ERR) {
+            SetError(REDIS_ERR_PROTOCOL, "Bad integer value");
+            return REDIS_ERR;
+        }
+        obj = _fn->createInteger(cur, v);
+    } else if (cur->type == REDIS_REPLY_DOUBLE) {
+        char buf[326];
+        char *eptr;
+        double d;
+        if (len >= sizeof(buf)) {
+            SetError(REDIS_ERR_PROTOCOL, "Double value is too large");
+            return REDIS_ERR;
+        }
+        memcpy(buf, p, len);
+        buf[len] = '\0';
+        if (len == 3 && strcasecmp(buf, "inf") == 0) {
+            d = INFINITY;
+        } else if (len == 4 && strcasecmp(buf, "-inf") == 0) {
+            d = -INFINITY;
+        } else if ((len == 3 && strcasecmp(buf, "nan") == 0) || 
+                   (len == 4 && strcasecmp(buf, "-nan") == 0)) {
+            d = NAN;
+        } else {
+            d = strtod(buf, &eptr);
+            if (buf[0] == '\0' || eptr != &buf[len] || !isfinite(d)) {
+                SetError(REDIS_ERR_PROTOCOL, "Bad double value");
+                return REDIS_ERR;
+            }
+        }
+        obj = _fn->createDouble(cur, d, buf, len);
+    } else if (cur->type == REDIS_REPLY_NIL) {
+        if (len != 0) {
+            SetError(REDIS_ERR_PROTOCOL, "Bad nil value");
+            return REDIS_ERR;
+        }
+        obj = _fn->createNil(cur);
+    } else if (cur->type == REDIS_REPLY_BOOL) {
+        if (len != 1 || !strchr("tTfF", p[0])) {
+            SetError(REDIS_ERR_PROTOCOL, "Bad bool value");
+            return REDIS_ERR;
+        }
+        obj = _fn->createBool(cur, p[0] == 't' || p[0] == 'T');
+    } else if (cur->type == REDIS_REPLY_BIGNUM) {
+        for (size_t i = 0; i < len; i++) {
+            if (i == 0 && p[0] == '-') {
+                continue;
+            }
+            if (p[i] < '0' || p[i] > '9') {
+                SetError(REDIS_ERR_PROTOCOL, "Bad bignum value");
+                return REDIS_ERR;
+            }
+        }
+        obj = _fn->createString(cur, (char *)p, len);
+    } else {
+        // status or error, the line ends at the first CRLF so only a bare 
+        //   '\r' or '\n' can be left inside
+        if (memchr(p, '\r', len) || memchr(p, '\n', len)) {
+            SetError(REDIS_ERR_PROTOCOL, "Bad simple string value");
+            return REDIS_ERR;
+        }
+        obj = _fn->createString(cur, (char *)p, len);
+    }
+
+    if (obj == NULL) {
+        SetError(REDIS_ERR_OOM, "Out of memory");
+        return REDIS_ERR;
+    }
+    if (_ridx == 0) {
+        _reply = obj;
+    }
+    MoveToNextTask();
+    return REDIS_OK;
+}
+
+int RespReader::ProcessBulkItem(redisReadTask *cur)
+{
+    const char *p = _buf + _pos;
+    const char *s = FindCRLF(p, _buf + _len);
+    if (s == NULL) {
+        return REDIS_ERR;
+    }
+
+    long long len;
+    size_t bytelen = s - p + 2;
+    if (ParseInteger(p, bytelen - 2, &len) == REDIS_ERR) {
+        SetError(REDIS_ERR_PROTOCOL, "Bad bulk string length");
+        return REDIS_ERR;
+    }
+    if (len < -1 || (LLONG_MAX > SIZE_MAX && len > (long long)SIZE_MAX)) {
+        SetError(REDIS_ERR_PROTOCOL, "Bulk string length out of range");
+        return REDIS_ERR;
+    }
+
+    void *obj;
+    if (len == -1) {
+        obj = _fn->createNil(cur);
+    } else {
+        // the payload is never scanned, wait until all of it is buffered
+        bytelen += len + 2;
+        if (_pos + bytelen > _len) {
+            return REDIS_ERR;
+        }
+        if (cur->type == REDIS_REPLY_VERB && (len < 4 || s[5] != ':')) {
+            SetError(REDIS_ERR_PROTOCOL, 
+                     "Verbatim string 4 bytes of content type are "
+                     "missing or incorrectly encoded.");
+            return REDIS_ERR;
+        }
+        obj = _fn->createString(cur, (char *)s + 2, len);
+    }
+
+    if (obj == NULL) {
+        SetError(REDIS_ERR_OOM, "Out of memory");
+        return REDIS_ERR;
+    }
+    _pos += bytelen;
+    if (_ridx == 0) {
+        _reply = obj;
+    }
+    MoveToNextTask();
+    return REDIS_OK;
+}
+
+int RespReader::ProcessAggregateItem(redisReadTask *cur)
+{
+    if (_ridx == (int)_tasks.size() - 1) {
+        _tasks.push_back(new redisReadTask());
+    }
+
+    size_t len;
+    const char *p = ReadLine(&len);
+    if (p == NULL) {
+        return REDIS_ERR;
+    }
+
+    long long elements;
+    if (ParseInteger(p, len, &elements) == REDIS_ERR) {
+        SetError(REDIS_ERR_PROTOCOL, "Bad multi-bulk length");
+        return REDIS_ERR;
+    }
+    if (elements < -1 || 
+        (LLONG_MAX > SIZE_MAX && elements > (long long)SIZE_MAX) || 
+        (_maxelements > 0 && elements > _maxelements)) {
+        SetError(REDIS_ERR_PROTOCOL, "Multi-bulk length out of range");
+        return REDIS_ERR;
+    }
+
+    bool root = (_ridx == 0);
+    void *obj;
+    if (elements == -1) {
+        obj = _fn->createNil(cur);
+        if (obj == NULL) {
+            SetError(REDIS_ERR_OOM, "Out of memory");
+            return REDIS_ERR;
+        }
+        MoveToNextTask();
+    } else {
+        if (cur->type == REDIS_REPLY_MAP || cur->type == REDIS_REPLY_ATTR) {
+            elements *= 2;
+        }
+        obj = _fn->createArray(cur, elements);
+        if (obj == NULL) {
+            SetError(REDIS_ERR_OOM, "Out of memory");
+            return REDIS_ERR;
+        }
+        if (elements > 0) {
+            cur->elements = elements;
+            cur->obj = obj;
+            _ridx++;
+            redisReadTask *child = _tasks[_ridx];
+            child->type = -1;
+            child->elements = -1;
+            child->idx = 0;
+            child->obj = NULL;
+            child->parent = cur;
+            child->privdata = _privdata;
+        } else {
+            MoveToNextTask();
+        }
+    }
+
+    if (root) {
+        _reply = obj;
+    }
+    return REDIS_OK;
+}
+
+int RespReader::ProcessItem()
+{
+    redisReadTask *cur = _tasks[_ridx];
+
+    if (cur->type < 0) {
+        if (_pos >= _len) {
+            return REDIS_ERR;
+        }
+        switch (_buf[_pos]) {
+        case '-': cur->type = REDIS_REPLY_ERROR; break;
+        case '+': cur->type = REDIS_REPLY_STATUS; break;
+        case ':': cur->type = REDIS_REPLY_INTEGER; break;
+        case ',': cur->type = REDIS_REPLY_DOUBLE; break;
+        case '_': cur->type = REDIS_REPLY_NIL; break;
+        case '$': cur->type = REDIS_REPLY_STRING; break;
+        case '*': cur->type = REDIS_REPLY_ARRAY; break;
+        case '%': cur->type = REDIS_REPLY_MAP; break;
+        case '|': cur->type = REDIS_REPLY_ATTR; break;
+        case '~': cur->type = REDIS_REPLY_SET; break;
+        case '#': cur->type = REDIS_REPLY_BOOL; break;
+        case '=': cur->type = REDIS_REPLY_VERB; break;
+        case '>': cur->type = REDIS_REPLY_PUSH; break;
+        case '(': cur->type = REDIS_REPLY_BIGNUM; break;
+        default: {
+            char errstr[64];
+            snprintf(errstr, sizeof(errstr), 
+                     "Protocol error, got \"\\x%02x\" as reply type byte", 
+                     (unsigned char)_buf[_pos]);
+            SetError(REDIS_ERR_PROTOCOL, errstr);
+            return REDIS_ERR;
+        }
+        }
+        _pos++;
+    }
+
+    switch (cur->type) {
+    case REDIS_REPLY_ERROR:
+    case REDIS_REPLY_STATUS:
+    case REDIS_REPLY_INTEGER:
+    case REDIS_REPLY_DOUBLE:
+    case REDIS_REPLY_NIL:
+    case REDIS_REPLY_BOOL:
+    case REDIS_REPLY_BIGNUM:
+        return ProcessLineItem(cur);
+    case REDIS_REPLY_STRING:
+    case REDIS_REPLY_VERB:
+        return ProcessBulkItem(cur);
+    case REDIS_REPLY_ARRAY:
+    case REDIS_REPLY_MAP:
+    case REDIS_REPLY_ATTR:
+    case REDIS_REPLY_SET:
+    case REDIS_REPLY_PUSH:
+        return ProcessAggregateItem(cur);
+    default:
+        return REDIS_ERR;
+    }
+}
+
+/////////////////////// CONTEXT INTEGRATION ///////////////////////////////
+
+static void FreeReader(void *privdata)
+{
+    delete (RespReader *)privdata;
+}
+
+RespReader *RespReader::Attach(redisContext *context)
+{
+    if (context->privdata != NULL) {
+        return context->free_privdata == FreeReader ? 
+               (RespReader *)context->privdata : NULL;
+    }
+    RespReader *reader = new RespReader();
+    context->privdata = reader;
+    context->free_privdata = FreeReader;
+    return reader;
+}
+
+int RespReader::GetReply(redisContext *context, void **reply)
+{
+    RespReader *reader = Attach(context);
+    if (reader == NULL) {
+        return redisGetReply(context, reply);
+    }
+    reader->SetFunctions(context->reader->fn, context->reader->privdata);
+
+    *reply = NULL;
+    int done = 0;
+    while (!done) {
+        if (redisBufferWrite(context, &done) != REDIS_OK) {
+            return REDIS_ERR;
+        }
+    }
+
+    while (*reply == NULL) {
+        if (reader->GetReply(reply) != REDIS_OK) {
+            context->err = reader->GetError();
+            snprintf(context->errstr, sizeof(context->errstr), "%s", 
+                     reader->GetErrorStr());
+            return REDIS_ERR;
+        }
+        if (*reply != NULL) {
+            break;
+        }
+
+        char *buf = reader->Reserve(RESP_READER_READ_SIZE);
+        if (buf == NULL) {
+            context->err = REDIS_ERR_OOM;
+            snprintf(context->errstr, sizeof(context->errstr), "Out of memory");
+            return REDIS_ERR;
+        }
+        ssize_t nread = recv(context->fd, buf, RESP_READER_READ_SIZE, 0);
+        if (nread > 0) {
+            reader->Commit(nread);
+        } else if (nread < 0 && errno == EINTR) {
+            continue;
+        } else {
+            context->err = nread == 0 ? REDIS_ERR_EOF : REDIS_ERR_IO;
+            snprintf(context->errstr, sizeof(context->errstr), "%s", 
+                     nread == 0 ? "Server closed the connection" : 
+                     strerror(errno));
+            return REDIS_ERR;
+        }
+    }
+    return REDIS_OK;
+}
+
+//   The hiredis async engine always parses with its own reader, so async 
+// contexts get their own libevent glue. Writes, connects, timeouts and every
+// failure still go through hiredis; only the reading and the reply dispatch
+// of an established connection is done here.
+struct RespEvents
+{
+    redisAsyncContext *context;
+    RespReader *reader;
+    struct event *rev;
+    struct event *wev;
+    struct event *tev;
+};
+
+//   Pops the oldest pending callback like hiredis's __redisShiftCallback, which
+// is static in async.c. The entry was allocated by hiredis, so it is released
+// with hi_free and not the libc free.
+static redisCallback *ShiftCallback(redisAsyncContext *context)
+{
+    redisCallback *cb = context->replies.head;
+    if (cb != NULL) {
+        context->replies.head = cb->next;
+        if (context->replies.head == NULL) {
+            context->replies.tail = NULL;
+        }
+    }
+    return cb;
+}
+
+static void ProcessReplies(redisAsyncContext *context, RespReader *reader)
+{
+    redisContext *c = &context->c;
+    void *reply;
+
+    while (true) {
+        if (reader->GetReply(&reply) != REDIS_OK) {
+            c->err = context->err = reader->GetError();
+            snprintf(c->errstr, sizeof(c->errstr), "%s", reader->GetErrorStr());
+            context->errstr = c->errstr;
+            redisAsyncFree(context);
+            return;
+        }
+        if (reply == NULL) {
+            return;
+        }
+
+        redisCallback *cb = NULL;
+        if (((redisReply *)reply)->type == REDIS_REPLY_PUSH) {
+            // RESP3 pushes go to the push callback as in hiredis, the cluster
+            // clients never subscribe
+            if (context->push_cb) {
+                c->flags |= REDIS_IN_CALLBACK;
+                context->push_cb(context, reply);
+                c->flags &= ~REDIS_IN_CALLBACK;
+            }
+        } else if ((cb = ShiftCallback(context)) == NULL) {
+            //   An error nobody asked for (max clients, loading) comes right
+            // before the server closes the connection, it is reported and the
+            // context disconnected like hiredis does.
+            if (((redisReply *)reply)->type == REDIS_REPLY_ERROR) {
+                c->err = context->err = REDIS_ERR_OTHER;
+                snprintf(c->errstr, sizeof(c->errstr), "%s", 
+                         ((redisReply *)reply)->str);
+                context->errstr = c->errstr;
+                reader->GetFunctions()->freeObject(reply);
+                redisAsyncDisconnect(context);
+                return;
+            }
+        } else {
+            if (cb->fn) {
+                c->flags |= REDIS_IN_CALLBACK;
+                cb->fn(context, reply, cb->privdata);
+                c->flags &= ~REDIS_IN_CALLBACK;
+            }
+        }
+        reader->GetFunctions()->freeObject(reply);
+        if (cb) {
+            hi_free(cb);
+        }
+
+        // frees and disconnects requested by the callback were deferred
+        if (c->flags & REDIS_FREEING) {
+            redisAsyncFree(context);
+            return;
+        }
+        if ((c->flags & REDIS_DISCONNECTING) && context->replies.head == NULL) {
+            redisAsyncDisconnect(context);
+            return;
+        }
+    }
+}
+
+static void OnReadEvent(evutil_socket_t fd, short, void *arg)
+{
+    RespEvents *e = (RespEvents *)arg;
+    redisAsyncContext *context = e->context;
+    redisContext *c = &context->c;
+
+    if (!(c->flags & REDIS_CONNECTED)) {
+        redisAsyncHandleRead(context);
+        return;
+    }
+
+    char *buf = e->reader->Reserve(RESP_READER_READ_SIZE);
+    if (buf == NULL) {
+        redisAsyncHandleRead(context);
+        return;
+    }
+    ssize_t nread = recv(fd, buf, RESP_READER_READ_SIZE, 0);
+    if (nread <= 0) {
+        if (nread < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        }
+        // let hiredis see the EOF or error and tear the context down
+        redisAsyncHandleRead(context);
+        return;
+    }
+    e->reader->Commit(nread);
+    e->reader->SetFunctions(c->reader->fn, c->reader->privdata);
+
+    // the command timeout runs from the last read, as hiredis re-arms it
+    if (context->replies.head && c->command_timeout && 
+            (c->command_timeout->tv_sec || c->command_timeout->tv_usec)) {
+        context->ev.scheduleTimer(context->ev.data, *c->command_timeout);
+    }
+    ProcessReplies(context, e->reader);
+}
+
+static void OnWriteEvent(evutil_socket_t, short, void *arg)
+{
+    redisAsyncHandleWrite(((RespEvents *)arg)->context);
+}
+
+static void OnTimerEvent(evutil_socket_t, short, void *arg)
+{
+    redisAsyncHandleTimeout(((RespEvents *)arg)->context);
+}
+
+static void AddRead(void *privdata) { event_add(((RespEvents *)privdata)->rev, NULL); }
+static void DelRead(void *privdata) { event_del(((RespEvents *)privdata)->rev); }
+static void AddWrite(void *privdata) { event_add(((RespEvents *)privdata)->wev, NULL); }
+static void DelWrite(void *privdata) { event_del(((RespEvents *)privdata)->wev); }
+
+static void ScheduleTimer(void *privdata, struct timeval tv)
+{
+    event_add(((RespEvents *)privdata)->tev, &tv);
+}
+
+static void Cleanup(void *privdata)
+{
+    RespEvents *e = (RespEvents *)privdata;
+    event_free(e->rev);
+    event_free(e->wev);
+    event_free(e->tev);
+    delete e->reader;
+    delete e;
+}
+
+int RespReader::LibeventAttach(redisAsyncContext *context, struct event_base *base)
+{
+    if (context->ev.data != NULL) {
+        return REDIS_ERR;
+    }
+
+    RespEvents *e = new RespEvents();
+    e->context = context;
+    e->reader = new RespReader();
+    e->rev = event_new(base, context->c.fd, EV_READ | EV_PERSIST, OnReadEvent, e);
+    e->wev = event_new(base, context->c.fd, EV_WRITE | EV_PERSIST, OnWriteEvent, e);
+    e->tev = evtimer_new(base, OnTimerEvent, e);
+
+    context->ev.addRead = AddRead;
+    context->ev.delRead = DelRead;
+    context->ev.addWrite = AddWrite;
+    context->ev.delWrite = DelWrite;
+    context->ev.cleanup = Cleanup;
+    context->ev.scheduleTimer = ScheduleTimer;
+    context->ev.data = e;
+    return REDIS_OK;
+}
+
+} // RedisClusterAPI
@@ -0,0 +1,157 @@
+#include "shardedcluster.h"
+
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <functional>
+
+namespace RedisClusterAPI
+{
+
+ShardedAsyncCluster::ShardedAsyncCluster(const char *ip,
+                                         int port,
+                                         int connect_timeout,
+                                         int command_timeout,
+                                         int loops,
+                                         ShardPolicy policy,
+                                         bool pin,
+                                         bool debug)
+    : _policy(policy), _pin(pin), _running(false)
+{
+    if (loops < 1) {
+        loops = 1;
+    }
+    _shards = new std::vector<AsyncShard *>();
+    for (int i = 0; i < loops; i++) {
+        AsyncShard *shard = new AsyncShard();
+        shard->index = i;
+        shard->base = event_base_new();
+        shard->cluster = new AsyncCluster(ip, port, connect_timeout, command_timeout,
+                                          shard->base, NULL, debug);
+        shard->cluster->EnableSubmitQueue();
+        shard->thread = NULL;
+        // also keeps the loop running while it has nothing else to wait on
+        shard->stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        shard->stop = event_new(shard->base, shard->stopFd, EV_READ | EV_PERSIST,
+                                OnStop, shard);
+        event_add(shard->stop, NULL);
+        _shards->push_back(shard);
+    }
+}
+
+ShardedAsyncCluster::~ShardedAsyncCluster()
+{
+    Stop();
+
+    for (size_t i = 0; i < _shards->size(); i++) {
+        AsyncShard *shard = (*_shards)[i];
+        delete shard->cluster;
+        event_free(shard->stop);
+        close(shard->stopFd);
+        event_base_free(shard->base);
+        delete shard;
+    }
+    delete _shards;
+    _shards = NULL;
+}
+
+// connects every loop first, a loop starts only once all are connected
+bool ShardedAsyncCluster::Start()
+{
+    if (_running) {
+        return true;
+    }
+    for (size_t i = 0; i < _shards->size(); i++) {
+        if ((*_shards)[i]->cluster->Connect() == false) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < _shards->size(); i++) {
+        AsyncShard *shard = (*_shards)[i];
+        shard->thread = new std::thread(RunShard, shard, _pin);
+    }
+    _running = true;
+    return true;
+}
+
+// commands still queued are dropped when the loops are freed
+void ShardedAsyncCluster::Stop()
+{
+    if (_running == false) {
+        return;
+    }
+    uint64_t one = 1;
+    for (size_t i = 0; i < _shards->size(); i++) {
+        AsyncShard *shard = (*_shards)[i];
+        if (write(shard->stopFd, &one, sizeof(one)) < 0) {
+            // the counter is saturated, a wakeup is pending anyway
+        }
+    }
+    for (size_t i = 0; i < _shards->size(); i++) {
+        AsyncShard *shard = (*_shards)[i];
+        shard->thread->join();
+        delete shard->thread;
+        shard->thread = NULL;
+    }
+    _running = false;
+}
+
+bool ShardedAsyncCluster::Set(std::string_view key, std::string_view val, void *privdata)
+{
+    std::string_view argv[3] = { "SET", key, val };
+    return CommandArgv(key, privdata, 3, argv);
+}
+
+bool ShardedAsyncCluster::Get(std::string_view key, void *privdata)
+{
+    std::string_view argv[2] = { "GET", key };
+    return CommandArgv(key, privdata, 2, argv);
+}
+
+// fails only if the command cannot be queued, the arguments are copied
+bool ShardedAsyncCluster::CommandArgv(std::string_view key,
+                                      void *privdata,
+                                      int argc,
+                                      const std::string_view *argv)
+{
+    if (_running == false) {
+        return false;
+    }
+    return GetShard(GetShardIndex(key))->Submit(key, privdata, argc, argv);
+}
+
+int ShardedAsyncCluster::GetShardIndex(std::string_view key)
+{
+    size_t loops = _shards->size();
+    if (_policy == SHARD_BY_THREAD) {
+        return std::hash<std::thread::id>()(std::this_thread::get_id()) % loops;
+    }
+    return SlotHash::slotByKey(key.data(), key.length()) % loops;
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+void ShardedAsyncCluster::RunShard(AsyncShard *shard, bool pin)
+{
+    if (pin) {
+        unsigned int cpus = std::thread::hardware_concurrency();
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(shard->index % (cpus ? cpus : 1), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    event_base_dispatch(shard->base);
+}
+
+void ShardedAsyncCluster::OnStop(evutil_socket_t fd, short, void *arg)
+{
+    AsyncShard *shard = (AsyncShard *)arg;
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0) {
+        // spurious, nothing to reset
+    }
+    event_base_loopbreak(shard->base);
+}
+
+} // RedisClusterAPI
@@ -0,0 +1,308 @@
+#include "sharedtopology.h"
+#include "contextpolicy.h"
+
+#include <iostream>
+
+namespace RedisClusterAPI
+{
+
+#define REDIS_COMMAND_CLUSTER_SLOTS "CLUSTER SLOTS"
+#define EPOCH_RECORD_COUNT 256
+
+// one record per reading thread, an epoch of 0 means not reading
+struct alignas(64) EpochRecord
+{
+    std::atomic<uint64_t> epoch;
+    std::atomic<bool> used;
+};
+
+static EpochRecord _epochRecords[EPOCH_RECORD_COUNT];
+static std::atomic<uint64_t> _globalEpoch(1);
+
+// the record of a thread is claimed on its first read and released when
+// the thread exits
+struct EpochSlot
+{
+    EpochRecord *record;
+    int depth;
+    bool claimed;
+
+    EpochSlot() : record(NULL), depth(0), claimed(false) {}
+    ~EpochSlot()
+    {
+        if (record) {
+            record->epoch.store(0);
+            record->used.store(false);
+        }
+    }
+
+    EpochRecord *Get()
+    {
+        if (claimed == false) {
+            claimed = true;
+            for (int i = 0; i < EPOCH_RECORD_COUNT; i++) {
+                bool used = false;
+                if (_epochRecords[i].used.load(std::memory_order_relaxed) == false &&
+                    _epochRecords[i].used.compare_exchange_strong(used, true)) {
+                    record = &_epochRecords[i];
+                    break;
+                }
+            }
+        }
+        return record;
+    }
+};
+
+static thread_local EpochSlot _epochSlot;
+
+std::mutex SharedTopology::_registryLock;
+SharedTopology::Registry SharedTopology::_registry;
+
+SharedTopology::SharedTopology(const char *ip,
+                               int port,
+                               int connect_timeout,
+                               int command_timeout)
+    : _current(NULL), _version(0), _refreshCount(0), _port(port),
+      _connect_timeout(connect_timeout), _command_timeout(command_timeout),
+      _refs(0)
+{
+    memset(_ip, 0, sizeof(_ip));
+    strncpy(_ip, ip, sizeof(_ip) - 1);
+    _name = std::string(ip) + ":" + std::to_string(port);
+    _retired = new std::vector<Retired>();
+}
+
+// the last Release(), no reader is left
+SharedTopology::~SharedTopology()
+{
+    for (size_t i = 0; i < _retired->size(); i++) {
+        delete (*_retired)[i].snapshot;
+    }
+    delete _retired;
+    _retired = NULL;
+    delete _current.load();
+}
+
+// the timeouts of the first client are used for the refreshes
+SharedTopology *SharedTopology::Acquire(const char *ip,
+                                        int port,
+                                        int connect_timeout,
+                                        int command_timeout)
+{
+    std::string name = std::string(ip) + ":" + std::to_string(port);
+    std::lock_guard<std::mutex> lock(_registryLock);
+
+    Registry::iterator it = _registry.find(name);
+    if (it == _registry.end()) {
+        SharedTopology *topology = new SharedTopology(ip, port, connect_timeout, command_timeout);
+        it = _registry.insert(Registry::value_type(name, topology)).first;
+    }
+    it->second->_refs++;
+    return it->second;
+}
+
+void SharedTopology::Release(SharedTopology *topology)
+{
+    if (topology == NULL) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_registryLock);
+    if (--topology->_refs > 0) {
+        return;
+    }
+    _registry.erase(topology->_name);
+    delete topology;
+}
+
+UpdatePoolType SharedTopology::Refresh(uint64_t version)
+{
+    std::lock_guard<std::mutex> lock(_refreshLock);
+
+    // another client refreshed meanwhile
+    TopologySnapshot *current = _current.load(std::memory_order_acquire);
+    if (current && current->version != version) {
+        return UPDATE_TRUE;
+    }
+
+    // known masters first, the seed last
+    std::vector<TopologyNode> nodes;
+    bool fetched = false;
+    if (current) {
+        for (size_t i = 0; i < current->nodes.size() && fetched == false; i++) {
+            const TopologyNode &node = current->nodes[i];
+            fetched = FetchSlots(node.ip, node.port, _connect_timeout, _command_timeout, nodes);
+        }
+    }
+    if (fetched == false) {
+        fetched = FetchSlots(_ip, _port, _connect_timeout, _command_timeout, nodes);
+    }
+    if (fetched == false) {
+        return UPDATE_FALSE;
+    }
+    if (current && IsSame(current->nodes, nodes)) {
+        return UPDATE_UNCHANGED;
+    }
+
+    TopologySnapshot *snapshot = new TopologySnapshot();
+    snapshot->version = current ? current->version + 1 : 1;
+    snapshot->nodes.swap(nodes);
+
+    std::lock_guard<std::recursive_mutex> retireLock(_retireLock);
+    TopologySnapshot *old = _current.exchange(snapshot);
+    _version.store(snapshot->version, std::memory_order_release);
+    _refreshCount.fetch_add(1, std::memory_order_relaxed);
+    if (old) {
+        // readers from this epoch on cannot see 'old'
+        _retired->push_back({ old, EpochGuard::Retire() });
+    }
+    Reclaim();
+    return UPDATE_TRUE;
+}
+
+bool SharedTopology::FetchSlots(const char *ip,
+                                int port,
+                                int connect_timeout,
+                                int command_timeout,
+                                std::vector<TopologyNode> &nodes)
+{
+    ContextOptions opts(ip, port, connect_timeout, command_timeout);
+    redisContext *context = ContextPolicy<redisContext>::Connect(opts);
+    if (context == NULL || context->err) {
+        if (context) {
+            redisFree(context);
+        }
+        return false;
+    }
+
+    redisReply *reply = (redisReply *)redisCommand(context, REDIS_COMMAND_CLUSTER_SLOTS);
+    redisFree(context);
+    bool res = ParseSlots(reply, nodes);
+    freeReplyObject(reply);
+    return res;
+}
+
+bool SharedTopology::ParseSlots(const redisReply *reply, std::vector<TopologyNode> &nodes)
+{
+    if (reply == NULL || reply->type != REDIS_REPLY_ARRAY) {
+        return false;
+    }
+
+    nodes.clear();
+    for (size_t i = 0; i < reply->elements; i++) {
+        const redisReply *range = reply->element[i];
+        if (range->type != REDIS_REPLY_ARRAY ||
+            range->elements < 3 ||
+            range->element[0]->type != REDIS_REPLY_INTEGER ||
+            range->element[1]->type != REDIS_REPLY_INTEGER ||
+            range->element[2]->type != REDIS_REPLY_ARRAY ||
+            range->element[2]->elements < 3 ||
+            range->element[2]->element[0]->type != REDIS_REPLY_STRING ||
+            range->element[2]->element[1]->type != REDIS_REPLY_INTEGER ||
+            range->element[2]->element[2]->type != REDIS_REPLY_STRING)
+        {
+            return false;
+        }
+
+        TopologyNode node;
+        memset(&node, 0, sizeof(node));
+        node.slotStart = range->element[0]->integer;
+        node.slotEnd = range->element[1]->integer;
+        strncpy(node.ip, range->element[2]->element[0]->str, sizeof(node.ip) - 1);
+        node.port = range->element[2]->element[1]->integer;
+        strncpy(node.id, range->element[2]->element[2]->str, sizeof(node.id) - 1);
+        nodes.push_back(node);
+    }
+    return true;
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+bool SharedTopology::IsSame(const std::vector<TopologyNode> &a,
+                            const std::vector<TopologyNode> &b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].slotStart != b[i].slotStart || a[i].slotEnd != b[i].slotEnd ||
+            a[i].port != b[i].port || strcmp(a[i].ip, b[i].ip) || strcmp(a[i].id, b[i].id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// called under _retireLock. A snapshot retired at epoch E is unreachable
+// once every reading thread entered after E.
+void SharedTopology::Reclaim()
+{
+    uint64_t oldest = EpochGuard::GetOldestEpoch();
+    size_t kept = 0;
+    for (size_t i = 0; i < _retired->size(); i++) {
+        if ((*_retired)[i].epoch < oldest) {
+            delete (*_retired)[i].snapshot;
+        } else {
+            (*_retired)[kept++] = (*_retired)[i];
+        }
+    }
+    _retired->resize(kept);
+}
+
+///////////////////////////////// EPOCH GUARD //////////////////////////////////
+
+EpochGuard::EpochGuard(std::recursive_mutex *fallback)
+    : _fallback(fallback), _locked(false)
+{
+    EpochRecord *record = _epochSlot.Get();
+    if (record == NULL) {
+        // out of records, read under the lock instead
+        _fallback->lock();
+        _locked = true;
+    } else if (_epochSlot.depth++ == 0) {
+        // seq_cst, ordered before the load of the snapshot
+        record->epoch.store(_globalEpoch.load());
+    }
+}
+
+EpochGuard::~EpochGuard()
+{
+    if (_locked) {
+        _fallback->unlock();
+    } else if (--_epochSlot.depth == 0) {
+        _epochSlot.record->epoch.store(0, std::memory_order_release);
+    }
+}
+
+// called once the object is unpublished, readers entering from now on 
+// cannot reach it
+uint64_t EpochGuard::Retire()
+{
+    return _globalEpoch.fetch_add(1);
+}
+
+// an object retired at epoch E is unreachable once E is older than this
+uint64_t EpochGuard::GetOldestEpoch()
+{
+    uint64_t oldest = UINT64_MAX;
+    for (int i = 0; i < EPOCH_RECORD_COUNT; i++) {
+        uint64_t epoch = _epochRecords[i].epoch.load();
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    return oldest;
+}
+
+//////////////////////////// TOPOLOGY READER ///////////////////////////////////
+
+TopologyReader::TopologyReader(SharedTopology *topology)
+    : _topology(topology), _guard(&topology->_retireLock) {}
+
+TopologyReader::~TopologyReader() {}
+
+const TopologySnapshot *TopologyReader::Get()
+{
+    return _topology->_current.load();
+}
+
+} // RedisClusterAPI
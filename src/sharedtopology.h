@@ -0,0 +1,130 @@
+#pragma once
+#include <hiredis.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <mutex>
+
+#include "clustertypelist.h"
+
+namespace RedisClusterAPI
+{
+
+struct TopologyNode
+{
+    unsigned int slotStart;
+    unsigned int slotEnd;
+    char ip[46];           // an IPv6 address fits
+    int port;
+    char id[41];
+};
+
+// Read-side critical section of the epoch-based reclamation behind the 
+// lock-free snapshots (SharedTopology, the slot table of ConcurrentCluster).
+//   Guards nest within a thread. An object unpublished by a writer is 
+// stamped with Retire() and may be freed once its epoch is older than 
+// GetOldestEpoch(). A thread out of epoch records reads under 'fallback' 
+// instead, which the writer holds while it retires and frees.
+class EpochGuard
+{
+public:
+    EpochGuard(std::recursive_mutex *fallback);
+    ~EpochGuard();
+    EpochGuard(const EpochGuard &) = delete;
+    EpochGuard& operator=(const EpochGuard &) = delete;
+
+    static uint64_t Retire();
+    static uint64_t GetOldestEpoch();
+private:
+    std::recursive_mutex *_fallback;
+    bool _locked;
+};
+
+// immutable once published
+struct TopologySnapshot
+{
+    uint64_t version;
+    std::vector<TopologyNode> nodes;
+};
+
+// Process-wide cluster topology, shared by every client of the same seed.
+//   Readers get the current snapshot without a lock: a TopologyReader marks
+// its thread as reading with an EpochGuard, and a replaced snapshot is only
+// freed once no reader of an older epoch is left.
+// Refresh() runs CLUSTER SLOTS in one thread at a time. A caller that failed
+// on an older version returns as soon as a newer one is published, so a
+// failover costs one refresh no matter how many clients see it.
+class SharedTopology
+{
+public:
+    static SharedTopology *Acquire(const char *ip,
+                                   int port,
+                                   int connect_timeout,
+                                   int command_timeout);
+    static void Release(SharedTopology *topology);
+
+    UpdatePoolType Refresh(uint64_t version);
+    uint64_t GetVersion() { return _version.load(std::memory_order_acquire); }
+    uint64_t GetRefreshCount() { return _refreshCount.load(std::memory_order_relaxed); }
+public:
+    static bool FetchSlots(const char *ip,
+                           int port,
+                           int connect_timeout,
+                           int command_timeout,
+                           std::vector<TopologyNode> &nodes);
+    static bool ParseSlots(const redisReply *reply, std::vector<TopologyNode> &nodes);
+    static bool IsSame(const std::vector<TopologyNode> &a, const std::vector<TopologyNode> &b);
+private:
+    SharedTopology(const char *ip, int port, int connect_timeout, int command_timeout);
+    ~SharedTopology();
+    SharedTopology(const SharedTopology &) = delete;
+    SharedTopology& operator=(const SharedTopology &) = delete;
+
+    void Reclaim();
+private:
+    struct Retired {
+        TopologySnapshot *snapshot;
+        uint64_t epoch;
+    };
+    typedef std::map<std::string, SharedTopology *> Registry;
+
+    static std::mutex _registryLock;
+    static Registry _registry;
+
+    std::atomic<TopologySnapshot *> _current;
+    std::atomic<uint64_t> _version;
+    std::atomic<uint64_t> _refreshCount;
+    std::mutex _refreshLock;
+    std::recursive_mutex _retireLock; // also taken by readers without an epoch record
+    std::vector<Retired> *_retired;   // guarded by _retireLock
+    std::string _name;
+    char _ip[32];
+    int _port;
+    int _connect_timeout;
+    int _command_timeout;
+    int _refs;                        // guarded by _registryLock
+
+    friend class TopologyReader;
+};
+
+// Read-side critical section, the snapshot from Get() stays valid until the
+// reader is destroyed. Readers nest within a thread.
+class TopologyReader
+{
+public:
+    TopologyReader(SharedTopology *topology);
+    ~TopologyReader();
+    TopologyReader(const TopologyReader &) = delete;
+    TopologyReader& operator=(const TopologyReader &) = delete;
+
+    const TopologySnapshot *Get();
+private:
+    SharedTopology *_topology;
+    EpochGuard _guard;
+};
+
+} // RedisClusterAPI
@@ -0,0 +1,124 @@
+#include "slaballocator.h"
+
+namespace RedisClusterAPI
+{
+
+SlabAllocator::SlabAllocator(size_t objectSize, size_t objectsPerSlab)
+    : _freeList(NULL), _objectsPerSlab(objectsPerSlab), _inUse(0)
+{
+    if (objectSize < sizeof(FreeNode)) {
+        objectSize = sizeof(FreeNode);
+    }
+    // keep every object aligned like malloc() does
+    size_t align = alignof(std::max_align_t);
+    _objectSize = (objectSize + align - 1) & ~(align - 1);
+
+    if (_objectsPerSlab == 0) {
+        _objectsPerSlab = 1;
+    }
+    _slabs = new std::vector<char *>();
+}
+
+SlabAllocator::~SlabAllocator()
+{
+    std::vector<char *>::iterator it;
+    for (it = _slabs->begin(); it != _slabs->end(); it++) {
+        free(*it);
+    }
+    delete _slabs;
+    _slabs = NULL;
+}
+
+void *SlabAllocator::Allocate()
+{
+    if (_freeList == NULL) {
+        char *slab = (char *)malloc(_objectSize * _objectsPerSlab);
+        if (slab == NULL) {
+            return NULL;
+        }
+        _slabs->push_back(slab);
+
+        for (size_t i = _objectsPerSlab; i > 0; i--) {
+            FreeNode *node = (FreeNode *)(slab + (i - 1) * _objectSize);
+            node->next = _freeList;
+            _freeList = node;
+        }
+    }
+
+    FreeNode *node = _freeList;
+    _freeList = node->next;
+    _inUse++;
+    return (void *)node;
+}
+
+void SlabAllocator::Free(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    FreeNode *node = (FreeNode *)ptr;
+    node->next = _freeList;
+    _freeList = node;
+    _inUse--;
+}
+
+FramePool::FramePool(size_t objectsPerSlab) : _heapCount(0)
+{
+    _classes = new std::vector<SlabAllocator *>();
+    for (int i = 0; i < FRAME_POOL_CLASSES; i++) {
+        _classes->push_back(new SlabAllocator((size_t)FRAME_POOL_MIN_SIZE << i, 
+                                              objectsPerSlab));
+    }
+}
+
+FramePool::~FramePool()
+{
+    for (size_t i = 0; i < _classes->size(); i++) {
+        delete (*_classes)[i];
+    }
+    delete _classes;
+    _classes = NULL;
+}
+
+void *FramePool::Allocate(size_t size)
+{
+    int index = GetClass(size);
+    if (index < 0) {
+        _heapCount++;
+        return malloc(size);
+    }
+
+    SlabAllocator *slab = (*_classes)[index];
+    size_t slabCount = slab->GetSlabCount();
+    void *ptr = slab->Allocate();
+    if (slab->GetSlabCount() != slabCount) {
+        _heapCount++;
+    }
+    return ptr;
+}
+
+void FramePool::Free(void *ptr, size_t size)
+{
+    int index = GetClass(size);
+    if (index < 0) {
+        free(ptr);
+        return;
+    }
+    (*_classes)[index]->Free(ptr);
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+int FramePool::GetClass(size_t size)
+{
+    size_t classSize = FRAME_POOL_MIN_SIZE;
+    for (int i = 0; i < FRAME_POOL_CLASSES; i++, classSize <<= 1) {
+        if (size <= classSize) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+} // RedisClusterAPI
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+#define FRAME_POOL_MIN_SIZE 64
+#define FRAME_POOL_CLASSES 7     // 64 bytes to 4KB, larger ones use the heap
+
+namespace RedisClusterAPI
+{
+
+// Fixed-size object allocator.
+//   Memory is taken from the heap one slab of 'objectsPerSlab' objects at a 
+// time and freed objects are kept in a free list, so the steady state does
+// no heap allocation at all. Not thread-safe, one allocator per event loop.
+class SlabAllocator
+{
+public:
+    SlabAllocator(size_t objectSize, size_t objectsPerSlab = 1024);
+    ~SlabAllocator();
+    SlabAllocator(const SlabAllocator &) = delete;
+    SlabAllocator& operator=(const SlabAllocator &) = delete;
+
+    void *Allocate();
+    void Free(void *ptr);
+public:
+    size_t GetObjectSize() { return _objectSize; }
+    size_t GetSlabCount() { return _slabs->size(); }
+    uint64_t GetInUseCount() { return _inUse; }
+private:
+    struct FreeNode {
+        FreeNode *next;
+    };
+private:
+    std::vector<char *> *_slabs;
+    FreeNode *_freeList;
+    size_t _objectSize;
+    size_t _objectsPerSlab;
+    uint64_t _inUse;
+};
+
+// Variable-size allocator over power-of-two SlabAllocator size classes, for
+// objects like coroutine frames whose size is only known at allocation time.
+//   Free() needs the size given to Allocate(). Not thread-safe either.
+class FramePool
+{
+public:
+    FramePool(size_t objectsPerSlab = 64);
+    ~FramePool();
+    FramePool(const FramePool &) = delete;
+    FramePool& operator=(const FramePool &) = delete;
+
+    void *Allocate(size_t size);
+    void Free(void *ptr, size_t size);
+public:
+    uint64_t GetHeapCount() { return _heapCount; }
+private:
+    int GetClass(size_t size);
+private:
+    std::vector<SlabAllocator *> *_classes;
+    uint64_t _heapCount;   // slabs and oversized objects taken from the heap
+};
+
+} // RedisClusterAPI
@@ -0,0 +1,106 @@
+#include "submitqueue.h"
+#include "asynccluster.h"
+
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+namespace RedisClusterAPI
+{
+
+SubmitQueue::SubmitQueue(AsyncCluster *asyncCluster, size_t capacity, size_t batch)
+    : _asyncCluster(asyncCluster), _batch(batch > 0 ? batch : 1), _signaled(false),
+      _submitted(0), _full(0), _wakeups(0), _batches(0), _drained(0)
+{
+    _queue = new MpscQueue<SubmittedCommand>(capacity);
+    _eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    _event = event_new(asyncCluster->GetEvBase(), _eventFd, EV_READ | EV_PERSIST,
+                       OnWakeup, this);
+    event_add(_event, NULL);
+}
+
+// commands never drained are dropped
+SubmitQueue::~SubmitQueue()
+{
+    event_free(_event);
+    _event = NULL;
+    close(_eventFd);
+
+    SubmittedCommand command;
+    while (_queue->Pop(command)) {
+        free(command.cmd);
+    }
+    delete _queue;
+    _queue = NULL;
+}
+
+// any thread. Takes the command, the caller keeps it when the queue is full
+bool SubmitQueue::Push(SubmittedCommand &command)
+{
+    if (_queue->Push(std::move(command)) == false) {
+        _full.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    _submitted.fetch_add(1, std::memory_order_relaxed);
+
+    // seq_cst, pairs with the store in OnWakeup() made before draining
+    if (_signaled.exchange(true) == false) {
+        uint64_t one = 1;
+        if (write(_eventFd, &one, sizeof(one)) < 0) {
+            // the counter is saturated, a wakeup is pending anyway
+        }
+        _wakeups.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+void SubmitQueue::OnWakeup(evutil_socket_t fd, short, void *arg)
+{
+    SubmitQueue *queue = (SubmitQueue *)arg;
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0) {
+        // re-activated by Drain(), nothing to reset
+    }
+    // producers from now on signal again
+    queue->_signaled.store(false);
+    queue->Drain();
+}
+
+// loop thread. A full batch may leave commands behind, the event is made
+// active again so the replies already read are handled first.
+void SubmitQueue::Drain()
+{
+    SubmittedCommand command;
+    size_t count = 0;
+
+    _asyncCluster->Cork();
+    while (count < _batch && _queue->Pop(command)) {
+        count++;
+        AsyncClusterPriority priority(_asyncCluster, command.priority);
+        if (command.handler) {
+            if (_asyncCluster->FormattedCommand(command.key, command.handler,
+                                                command.cmd, command.cmdlen) == false) {
+                command.handler(NULL);
+                command.handler.Reset();
+            }
+            continue;
+        }
+        if (_asyncCluster->FormattedCommand(command.key, command.privdata,
+                                            command.cmd, command.cmdlen) == false) {
+            AsyncClusterCallback *callback = _asyncCluster->GetCallback();
+            if (callback) {
+                callback->OnCommand(NULL, (void *)_asyncCluster, command.privdata);
+            }
+        }
+    }
+    _asyncCluster->Uncork();
+
+    _batches++;
+    _drained += count;
+    if (count == _batch) {
+        event_active(_event, EV_READ, 0);
+    }
+}
+
+} // RedisClusterAPI
@@ -0,0 +1,72 @@
+#pragma once
+#include "event2/event.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <string_view>
+#include <atomic>
+
+#include "clustertypelist.h"
+#include "mpscqueue.h"
+#include "completionhandler.h"
+
+#define SUBMIT_QUEUE_CAPACITY 65536
+#define SUBMIT_QUEUE_BATCH 256
+
+namespace RedisClusterAPI
+{
+
+class AsyncCluster;
+
+// command formatted by the submitting thread, dispatched by the loop
+struct SubmittedCommand
+{
+    std::string key;
+    char *cmd;
+    int cmdlen;
+    void *privdata;
+    CompletionHandler handler;   // used instead of 'privdata' if set
+    CommandPriority priority;
+};
+
+// Thread-safe submission into the event loop of an AsyncCluster.
+//   Commands go through a bounded MpscQueue. A producer only writes the
+// eventfd when it finds the loop unsignaled, so a burst of submissions costs
+// one wakeup. The loop clears the signal before it drains, then dispatches
+// up to 'batch' commands per wakeup inside one Cork()/Uncork(), each with 
+// the priority it was submitted with, and yields to I/O before it goes on 
+// with the rest.
+class SubmitQueue
+{
+public:
+    SubmitQueue(AsyncCluster *asyncCluster, size_t capacity, size_t batch);
+    ~SubmitQueue();
+    SubmitQueue(const SubmitQueue &) = delete;
+    SubmitQueue& operator=(const SubmitQueue &) = delete;
+
+    bool Push(SubmittedCommand &command);
+public:
+    uint64_t GetSubmitCount() { return _submitted.load(std::memory_order_relaxed); }
+    uint64_t GetFullCount() { return _full.load(std::memory_order_relaxed); }
+    uint64_t GetWakeupCount() { return _wakeups.load(std::memory_order_relaxed); }
+    uint64_t GetBatchCount() { return _batches; }
+    uint64_t GetDrainCount() { return _drained; }
+private:
+    static void OnWakeup(evutil_socket_t fd, short what, void *arg);
+    void Drain();
+private:
+    AsyncCluster *_asyncCluster;
+    MpscQueue<SubmittedCommand> *_queue;
+    struct event *_event;
+    int _eventFd;
+    size_t _batch;
+    std::atomic<bool> _signaled;
+    std::atomic<uint64_t> _submitted;
+    std::atomic<uint64_t> _full;
+    std::atomic<uint64_t> _wakeups;
+    uint64_t _batches;    // loop thread only
+    uint64_t _drained;
+};
+
+} // RedisClusterAPI
@@ -0,0 +1,363 @@
+#include "valuecodec.h"
+
+namespace RedisClusterAPI
+{
+
+#define LZ4_MINMATCH 4
+#define LZ4_MFLIMIT 12
+#define LZ4_LASTLITERALS 5
+#define LZ4_MAXOFFSET 65535
+#define LZ4_HASHLOG 12
+
+static const unsigned char CODEC_MAGIC[2] = { 0xC7, 'Z' };
+
+static inline uint32_t Read32(const char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t Hash32(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - LZ4_HASHLOG);
+}
+
+static inline char *WriteLength(char *op, size_t len)
+{
+    while (len >= 255) {
+        *op++ = (char)255;
+        len -= 255;
+    }
+    *op++ = (char)len;
+    return op;
+}
+
+/////////////////////////////// LZ4 CODEC ///////////////////////////////////
+
+Lz4Codec *Lz4Codec::GetInstance()
+{
+    static Lz4Codec codec;
+    return &codec;
+}
+
+size_t Lz4Codec::Compress(const char *src, size_t len, char *dst, size_t cap)
+{
+    int64_t table[1 << LZ4_HASHLOG];
+    for (size_t i = 0; i < (1 << LZ4_HASHLOG); i++) {
+        table[i] = -1;
+    }
+
+    char *op = dst;
+    char *oend = dst + cap;
+    size_t anchor = 0;
+    size_t ip = 0;
+
+    while (len > LZ4_MFLIMIT && ip < len - LZ4_MFLIMIT) {
+        uint32_t seq = Read32(src + ip);
+        uint32_t h = Hash32(seq);
+        int64_t ref = table[h];
+        table[h] = ip;
+
+        if (ref < 0 || ip - ref > LZ4_MAXOFFSET || Read32(src + ref) != seq) {
+            ip++;
+            continue;
+        }
+
+        // the last LZ4_LASTLITERALS bytes are always literals
+        size_t mlen = LZ4_MINMATCH;
+        while (ip + mlen < len - LZ4_LASTLITERALS && src[ref + mlen] == src[ip + mlen]) {
+            mlen++;
+        }
+
+        size_t lit = ip - anchor;
+        if ((size_t)(oend - op) < 1 + lit / 255 + 1 + lit + 2 + mlen / 255 + 1) {
+            return 0;
+        }
+        char *token = op++;
+        *token = (char)((lit >= 15 ? 15 : lit) << 4);
+        if (lit >= 15) {
+            op = WriteLength(op, lit - 15);
+        }
+        memcpy(op, src + anchor, lit);
+        op += lit;
+
+        size_t offset = ip - ref;
+        *op++ = (char)(offset & 0xFF);
+        *op++ = (char)(offset >> 8);
+
+        size_t mcode = mlen - LZ4_MINMATCH;
+        *token |= (char)(mcode >= 15 ? 15 : mcode);
+        if (mcode >= 15) {
+            op = WriteLength(op, mcode - 15);
+        }
+
+        ip += mlen;
+        anchor = ip;
+    }
+
+    size_t lit = len - anchor;
+    if ((size_t)(oend - op) < 1 + lit / 255 + 1 + lit) {
+        return 0;
+    }
+    *op++ = (char)((lit >= 15 ? 15 : lit) << 4);
+    if (lit >= 15) {
+        op = WriteLength(op, lit - 15);
+    }
+    memcpy(op, src + anchor, lit);
+    op += lit;
+    return op - dst;
+}
+
+bool Lz4Codec::Decompress(const char *src, size_t len, char *dst, size_t rawlen)
+{
+    const unsigned char *ip = (const unsigned char *)src;
+    const unsigned char *iend = ip + len;
+    size_t op = 0;
+
+    while (ip < iend) {
+        unsigned int token = *ip++;
+
+        size_t lit = token >> 4;
+        if (lit == 15) {
+            unsigned char b;
+            do {
+                if (ip >= iend) {
+                    return false;
+                }
+                b = *ip++;
+                lit += b;
+            } while (b == 255);
+        }
+        if (lit > (size_t)(iend - ip) || lit > rawlen - op) {
+            return false;
+        }
+        memcpy(dst + op, ip, lit);
+        ip += lit;
+        op += lit;
+
+        // the last sequence has no match
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op) {
+            return false;
+        }
+
+        size_t mlen = token & 15;
+        if (mlen == 15) {
+            unsigned char b;
+            do {
+                if (ip >= iend) {
+                    return false;
+                }
+                b = *ip++;
+                mlen += b;
+            } while (b == 255);
+        }
+        mlen += LZ4_MINMATCH;
+        if (mlen > rawlen - op) {
+            return false;
+        }
+
+        // overlapping copy, byte by byte when the match repeats itself
+        char *match = dst + op - offset;
+        if (offset >= mlen) {
+            memcpy(dst + op, match, mlen);
+        } else {
+            for (size_t i = 0; i < mlen; i++) {
+                dst[op + i] = match[i];
+            }
+        }
+        op += mlen;
+    }
+    return op == rawlen;
+}
+
+//////////////////////////// VALUE COMPRESSOR ////////////////////////////////
+
+ValueCompressor::ValueCompressor()
+    : _encodeBuf(NULL), _encodeCap(0), _decodeBuf(NULL), _decodeCap(0), 
+      _maxValueSize(CODEC_MAX_VALUE_SIZE), _rawBytes(0), _wireBytes(0), _compressed(0)
+{
+    _rules = new std::vector<Rule>();
+}
+
+ValueCompressor::~ValueCompressor()
+{
+    free(_encodeBuf);
+    free(_decodeBuf);
+    delete _rules;
+    _rules = NULL;
+}
+
+void ValueCompressor::AddRule(std::string_view prefix, 
+                              ValueCodec *codec, 
+                              size_t threshold)
+{
+    std::vector<Rule>::iterator it;
+    for (it = _rules->begin(); it != _rules->end(); it++) {
+        if (it->prefix == prefix) {
+            it->codec = codec;
+            it->threshold = threshold;
+            return;
+        }
+    }
+    Rule rule = { std::string(prefix), codec, threshold };
+    _rules->push_back(rule);
+}
+
+bool ValueCompressor::Encode(std::string_view key, 
+                             std::string_view value, 
+                             std::string_view &output)
+{
+    const Rule *rule = FindRule(key);
+    bool magic = value.size() >= 2 && memcmp(value.data(), CODEC_MAGIC, 2) == 0;
+    _rawBytes += value.size();
+
+    if (rule && rule->codec && value.size() >= rule->threshold && 
+        value.size() > CODEC_HEADER_SIZE + 1 && value.size() <= UINT32_MAX) {
+        size_t cap = CODEC_HEADER_SIZE + rule->codec->Bound(value.size());
+        if (Reserve(&_encodeBuf, &_encodeCap, cap) == false) {
+            return false;
+        }
+        // only kept when it saves bytes
+        size_t clen = rule->codec->Compress(value.data(), value.size(), 
+                                            _encodeBuf + CODEC_HEADER_SIZE, 
+                                            value.size() - CODEC_HEADER_SIZE - 1);
+        if (clen > 0) {
+            uint32_t rawlen = value.size();
+            memcpy(_encodeBuf, CODEC_MAGIC, 2);
+            _encodeBuf[2] = rule->codec->GetId();
+            for (int i = 0; i < 4; i++) {
+                _encodeBuf[3 + i] = (char)((rawlen >> (8 * i)) & 0xFF);
+            }
+            output = std::string_view(_encodeBuf, CODEC_HEADER_SIZE + clen);
+            _wireBytes += output.size();
+            _compressed++;
+            return true;
+        }
+    }
+
+    if (magic == false) {
+        output = value;
+        _wireBytes += output.size();
+        return true;
+    }
+
+    if (Reserve(&_encodeBuf, &_encodeCap, CODEC_HEADER_SIZE + value.size()) == false) {
+        return false;
+    }
+    memcpy(_encodeBuf, CODEC_MAGIC, 2);
+    _encodeBuf[2] = CODEC_RAW;
+    memset(_encodeBuf + 3, 0, 4);
+    memcpy(_encodeBuf + CODEC_HEADER_SIZE, value.data(), value.size());
+    output = std::string_view(_encodeBuf, CODEC_HEADER_SIZE + value.size());
+    _wireBytes += output.size();
+    return true;
+}
+
+// values without the magic are returned as they are
+bool ValueCompressor::Decode(std::string_view value, std::string_view &output)
+{
+    _wireBytes += value.size();
+    if (value.size() < 2 || memcmp(value.data(), CODEC_MAGIC, 2) != 0) {
+        output = value;
+        _rawBytes += output.size();
+        return true;
+    }
+    if (value.size() < CODEC_HEADER_SIZE) {
+        return false;
+    }
+
+    uint8_t id = value[2];
+    if (id == CODEC_RAW) {
+        output = value.substr(CODEC_HEADER_SIZE);
+        _rawBytes += output.size();
+        return true;
+    }
+
+    ValueCodec *codec = FindCodec(id);
+    if (codec == NULL) {
+        return false;
+    }
+    uint32_t rawlen = 0;
+    for (int i = 0; i < 4; i++) {
+        rawlen |= (uint32_t)(unsigned char)value[3 + i] << (8 * i);
+    }
+    // the length comes from server data, it must not size the buffer as is
+    size_t clen = value.size() - CODEC_HEADER_SIZE;
+    if (rawlen > _maxValueSize || rawlen > codec->MaxRaw(clen)) {
+        return false;
+    }
+    if (Reserve(&_decodeBuf, &_decodeCap, (size_t)rawlen + 1) == false) {
+        return false;
+    }
+    if (codec->Decompress(value.data() + CODEC_HEADER_SIZE, 
+                          clen, _decodeBuf, rawlen) == false) {
+        return false;
+    }
+    _decodeBuf[rawlen] = '\0';
+    output = std::string_view(_decodeBuf, rawlen);
+    _rawBytes += output.size();
+    return true;
+}
+
+void ValueCompressor::ResetStats()
+{
+    _rawBytes = 0;
+    _wireBytes = 0;
+    _compressed = 0;
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+auto ValueCompressor::FindRule(std::string_view key) -> const Rule *
+{
+    const Rule *found = NULL;
+    std::vector<Rule>::iterator it;
+    for (it = _rules->begin(); it != _rules->end(); it++) {
+        if (key.compare(0, it->prefix.size(), it->prefix) == 0 && 
+            (found == NULL || it->prefix.size() > found->prefix.size())) {
+            found = &(*it);
+        }
+    }
+    return found;
+}
+
+ValueCodec *ValueCompressor::FindCodec(uint8_t id)
+{
+    std::vector<Rule>::iterator it;
+    for (it = _rules->begin(); it != _rules->end(); it++) {
+        if (it->codec && it->codec->GetId() == id) {
+            return it->codec;
+        }
+    }
+    // still readable once its rule has been removed
+    if (id == CODEC_LZ4) {
+        return Lz4Codec::GetInstance();
+    }
+    return NULL;
+}
+
+bool ValueCompressor::Reserve(char **buf, size_t *cap, size_t len)
+{
+    if (*cap >= len) {
+        return true;
+    }
+    char *tmp = (char *)realloc(*buf, len);
+    if (tmp == NULL) {
+        return false;
+    }
+    *buf = tmp;
+    *cap = len;
+    return true;
+}
+
+} // RedisClusterAPI
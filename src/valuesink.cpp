@@ -0,0 +1,86 @@
+#include "valuesink.h"
+#include "respreader.h"
+
+namespace RedisClusterAPI
+{
+
+redisReplyObjectFunctions ValueSink::_functions = {
+    ValueSink::CreateString,
+    ValueSink::CreateArray,
+    ValueSink::CreateInteger,
+    ValueSink::CreateDouble,
+    ValueSink::CreateNil,
+    ValueSink::CreateBool,
+    ValueSink::FreeObject
+};
+
+ValueSink::ValueSink(ValueCallback *callback, void *privdata)
+    : _callback(callback), _privdata(privdata), _delivered(false), 
+      _fn(NULL), _readerPrivdata(NULL) {}
+
+void ValueSink::Attach(redisContext *context)
+{
+    _fn = context->reader->fn;
+    _readerPrivdata = context->reader->privdata;
+    context->reader->fn = &_functions;
+    context->reader->privdata = (void *)this;
+}
+
+void ValueSink::Detach(redisContext *context)
+{
+    context->reader->fn = _fn;
+    context->reader->privdata = _readerPrivdata;
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+void *ValueSink::CreateString(const redisReadTask *task, char *str, size_t len)
+{
+    ValueSink *sink = (ValueSink *)task->privdata;
+    if (task->parent != NULL || task->type != REDIS_REPLY_STRING) {
+        return sink->_fn->createString(task, str, len);
+    }
+
+    redisReply *reply = (redisReply *)calloc(1, sizeof(redisReply));
+    if (reply == NULL) {
+        return NULL;
+    }
+    reply->type = REDIS_REPLY_STRING;
+    reply->len = len;
+    sink->_callback(std::string_view(str, len), sink->_privdata);
+    sink->_delivered = true;
+    return reply;
+}
+
+void *ValueSink::CreateArray(const redisReadTask *task, size_t elements)
+{
+    return ((ValueSink *)task->privdata)->_fn->createArray(task, elements);
+}
+
+void *ValueSink::CreateInteger(const redisReadTask *task, long long value)
+{
+    return ((ValueSink *)task->privdata)->_fn->createInteger(task, value);
+}
+
+void *ValueSink::CreateDouble(const redisReadTask *task, double value, char *str, size_t len)
+{
+    return ((ValueSink *)task->privdata)->_fn->createDouble(task, value, str, len);
+}
+
+void *ValueSink::CreateNil(const redisReadTask *task)
+{
+    return ((ValueSink *)task->privdata)->_fn->createNil(task);
+}
+
+void *ValueSink::CreateBool(const redisReadTask *task, int bval)
+{
+    return ((ValueSink *)task->privdata)->_fn->createBool(task, bval);
+}
+
+// sync contexts always build their replies with the hiredis defaults
+void ValueSink::FreeObject(void *reply)
+{
+    RespReader::DefaultFunctions()->freeObject(reply);
+}
+
+} // RedisClusterAPI
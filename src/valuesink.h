@@ -0,0 +1,54 @@
+#pragma once
+#include <hiredis.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <string_view>
+
+namespace RedisClusterAPI
+{
+
+typedef void ValueCallback(std::string_view value, void *privdata);
+
+// Hands the value of a bulk string reply to a callback while it is still in
+// the read buffer of the context.
+//   Attached to the reader through redisReplyObjectFunctions for one reply: 
+// the top-level string is delivered before any reply object is built and the
+// reply only keeps its type and length ('str' is NULL). Every other reply is 
+// built as usual, so errors and nil still reach the caller.
+class ValueSink
+{
+public:
+    ValueSink(ValueCallback *callback, void *privdata);
+    ValueSink(const ValueSink &) = delete;
+    ValueSink& operator=(const ValueSink &) = delete;
+
+    void Attach(redisContext *context);
+    void Detach(redisContext *context);
+    bool IsDelivered() { return _delivered; }
+private:
+    static void *CreateString(const redisReadTask *task, char *str, size_t len);
+    static void *CreateArray(const redisReadTask *task, size_t elements);
+    static void *CreateInteger(const redisReadTask *task, long long value);
+    static void *CreateDouble(const redisReadTask *task, double value, char *str, size_t len);
+    static void *CreateNil(const redisReadTask *task);
+    static void *CreateBool(const redisReadTask *task, int bval);
+    static void FreeObject(void *reply);
+private:
+    static redisReplyObjectFunctions _functions;
+    ValueCallback *_callback;
+    void *_privdata;
+    bool _delivered;
+    redisReplyObjectFunctions *_fn;  // functions of the reader, restored on Detach()
+    void *_readerPrivdata;
+};
+
+// destinations of the ValueCallback used by the Get() overloads of Cluster
+struct ValueBuffer
+{
+    char *buf;
+    size_t size;
+    size_t len;      // length of the value, even if it does not fit
+};
+
+} // RedisClusterAPI
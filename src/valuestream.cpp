@@ -0,0 +1,287 @@
+#include "valuestream.h"
+
+namespace RedisClusterAPI
+{
+
+ValueStreamer::ValueStreamer(AsyncCluster *asyncCluster, 
+                             uint32_t chunkSize, 
+                             uint32_t window)
+    : _asyncCluster(asyncCluster), _chunkSize(chunkSize), 
+      _window(window > 0 ? window : 1), _chunks(0), _bytes(0), _parked(0)
+{
+    _streams = new std::set<Stream *>();
+}
+
+ValueStreamer::~ValueStreamer()
+{
+    std::set<Stream *>::iterator it;
+    for (it = _streams->begin(); it != _streams->end(); it++) {
+        Stream *stream = *it;
+        for (size_t i = 0; i < stream->buffers.size(); i++) {
+            free(stream->buffers[i]);
+        }
+        delete stream;
+    }
+    delete _streams;
+    _streams = NULL;
+}
+
+bool ValueStreamer::Write(std::string_view key, StreamSource *source)
+{
+    Stream *stream = new Stream();
+    stream->key.assign(key.data(), key.length());
+    stream->source = source;
+    stream->sink = NULL;
+    stream->offset = 0;
+    stream->done = 0;
+    stream->inflight = 0;
+    stream->started = false;
+    stream->eof = false;
+    stream->failed = false;
+    stream->parked = false;
+
+    // the first chunk replaces the old value, the others wait for it
+    if (SendWriteChunk(stream) == false) {
+        for (size_t i = 0; i < stream->buffers.size(); i++) {
+            free(stream->buffers[i]);
+        }
+        delete stream;
+        return false;
+    }
+    _streams->insert(stream);
+    return true;
+}
+
+bool ValueStreamer::Read(std::string_view key, StreamSink *sink)
+{
+    Stream *stream = new Stream();
+    stream->key.assign(key.data(), key.length());
+    stream->source = NULL;
+    stream->sink = sink;
+    stream->offset = 0;
+    stream->done = 0;
+    stream->inflight = 0;
+    stream->started = true;
+    stream->eof = false;
+    stream->failed = false;
+    stream->parked = false;
+
+    if (SendReadChunk(stream) == false) {
+        delete stream;
+        return false;
+    }
+    _streams->insert(stream);
+    Pump(stream);
+    return true;
+}
+
+void ValueStreamer::OnCommand(redisReply *reply, void *, void *privdata)
+{
+    Chunk *chunk = (Chunk *)privdata;
+    Stream *stream = chunk->stream;
+
+    stream->inflight--;
+    if (stream->source) {
+        OnWriteReply(chunk, reply);
+    } else {
+        OnReadReply(chunk, reply);
+    }
+    delete chunk;
+
+    Pump(stream);
+    if (_parked > 0) {
+        ResumeParked();
+    }
+}
+
+void ValueStreamer::OnReady(const char *)
+{
+    if (_parked > 0) {
+        ResumeParked();
+    }
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+void ValueStreamer::Pump(Stream *stream)
+{
+    while (!stream->failed && !stream->eof && stream->started && 
+           stream->inflight < _window) 
+    {
+        // the source is only read once the chunk can be sent
+        if (_asyncCluster->IsQueueFull(stream->key, _chunkSize)) {
+            // with nothing on the wire no reply pumps it again
+            if (stream->inflight == 0) {
+                stream->parked = true;
+                _parked++;
+            }
+            break;
+        }
+        bool sent = stream->source ? SendWriteChunk(stream) : SendReadChunk(stream);
+        if (sent == false) {
+            stream->failed = true;
+        }
+    }
+
+    if (stream->inflight == 0 && (stream->eof || stream->failed)) {
+        Finish(stream);
+    }
+}
+
+// the node is unknown to the streamer, every parked stream checks again
+void ValueStreamer::ResumeParked()
+{
+    std::vector<Stream *> parked;
+    std::set<Stream *>::iterator it;
+    for (it = _streams->begin(); it != _streams->end(); it++) {
+        if ((*it)->parked) {
+            (*it)->parked = false;
+            parked.push_back(*it);
+        }
+    }
+    _parked = 0;
+
+    for (size_t i = 0; i < parked.size(); i++) {
+        Pump(parked[i]);
+    }
+}
+
+bool ValueStreamer::SendWriteChunk(Stream *stream)
+{
+    char *buf;
+    if (stream->buffers.empty()) {
+        buf = (char *)malloc(_chunkSize);
+        if (buf == NULL) {
+            return false;
+        }
+    } else {
+        buf = stream->buffers.back();
+        stream->buffers.pop_back();
+    }
+
+    size_t len = stream->source->Read(buf, _chunkSize);
+    if (len == 0 && stream->started) {
+        stream->buffers.push_back(buf);
+        stream->eof = true;
+        return true;
+    }
+
+    Chunk *chunk = new Chunk();
+    chunk->stream = stream;
+    chunk->offset = stream->offset;
+    chunk->buf = buf;
+    chunk->len = len;
+
+    // the chunk buffer stays untouched until its reply, retries included
+    bool res;
+    std::string_view value(buf, len);
+    if (stream->started == false) {
+        std::string_view argv[3] = { "SET", stream->key, value };
+        res = _asyncCluster->CommandArgv(stream->key, chunk, 3, argv, this);
+    } else {
+        std::string offset = std::to_string(stream->offset);
+        std::string_view argv[4] = { "SETRANGE", stream->key, offset, value };
+        res = _asyncCluster->CommandArgv(stream->key, chunk, 4, argv, this);
+    }
+    if (res == false) {
+        stream->buffers.push_back(buf);
+        delete chunk;
+        return false;
+    }
+
+    stream->offset += len;
+    stream->inflight++;
+    if (len == 0) {
+        stream->eof = true;
+    }
+    _chunks++;
+    return true;
+}
+
+bool ValueStreamer::SendReadChunk(Stream *stream)
+{
+    Chunk *chunk = new Chunk();
+    chunk->stream = stream;
+    chunk->offset = stream->offset;
+    chunk->buf = NULL;
+    chunk->len = _chunkSize;
+
+    std::string start = std::to_string(stream->offset);
+    std::string end = std::to_string(stream->offset + _chunkSize - 1);
+    std::string_view argv[4] = { "GETRANGE", stream->key, start, end };
+    if (_asyncCluster->CommandArgv(stream->key, chunk, 4, argv, this) == false) {
+        delete chunk;
+        return false;
+    }
+
+    stream->offset += _chunkSize;
+    stream->inflight++;
+    _chunks++;
+    return true;
+}
+
+void ValueStreamer::OnWriteReply(Chunk *chunk, redisReply *reply)
+{
+    Stream *stream = chunk->stream;
+    stream->buffers.push_back(chunk->buf);
+
+    if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
+        stream->failed = true;
+        return;
+    }
+    stream->started = true;
+    stream->done += chunk->len;
+    _bytes += chunk->len;
+}
+
+void ValueStreamer::OnReadReply(Chunk *chunk, redisReply *reply)
+{
+    Stream *stream = chunk->stream;
+
+    if (reply == NULL || reply->type != REDIS_REPLY_STRING) {
+        stream->failed = true;
+        return;
+    }
+    _bytes += reply->len;
+
+    // a short chunk is the last one, the ranges after it come back empty
+    if (reply->len < _chunkSize) {
+        stream->eof = true;
+    }
+    if (stream->failed || reply->len == 0) {
+        return;
+    }
+
+    // a retried chunk may come back after the ones requested after it
+    if (chunk->offset != stream->done) {
+        stream->pending[chunk->offset].assign(reply->str, reply->len);
+        return;
+    }
+    stream->sink->Write(std::string_view(reply->str, reply->len));
+    stream->done += reply->len;
+
+    std::map<uint64_t, std::string>::iterator it;
+    while ((it = stream->pending.find(stream->done)) != stream->pending.end()) {
+        stream->sink->Write(it->second);
+        stream->done += it->second.length();
+        stream->pending.erase(it);
+    }
+}
+
+void ValueStreamer::Finish(Stream *stream)
+{
+    _streams->erase(stream);
+    for (size_t i = 0; i < stream->buffers.size(); i++) {
+        free(stream->buffers[i]);
+    }
+
+    int status = stream->failed ? REDIS_ERR : REDIS_OK;
+    if (stream->source) {
+        stream->source->OnDone(status, stream->done);
+    } else {
+        stream->sink->OnDone(status, stream->done);
+    }
+    delete stream;
+}
+
+} // RedisClusterAPI
@@ -0,0 +1,207 @@
+#include "writecombiner.h"
+
+namespace RedisClusterAPI
+{
+
+WriteCombiner::WriteCombiner(AsyncCluster *asyncCluster, 
+                             int flush_interval, 
+                             uint32_t flush_size, 
+                             void *privdata)
+    : _asyncCluster(asyncCluster), _timer(NULL), _privdata(privdata), 
+      _flush_size(flush_size), _received(0), _flushed(0), _saved(0), 
+      _pendingOps(0), _issued(0), _backoff(false), _shutdown(false)
+{
+    _keyMap = new KeyMap();
+    _hashMap = new HashMap();
+
+    if (flush_interval > 0) {
+        timeval tv = { flush_interval / 1000, (flush_interval % 1000) * 1000 };
+        _timer = event_new(asyncCluster->GetEvBase(), -1, EV_PERSIST, 
+                           OnFlushTimer, this);
+        event_add(_timer, &tv);
+    }
+}
+
+WriteCombiner::~WriteCombiner()
+{
+    Shutdown();
+
+    delete _keyMap;
+    _keyMap = NULL;
+    delete _hashMap;
+    _hashMap = NULL;
+}
+
+bool WriteCombiner::Set(std::string_view key, std::string_view val)
+{
+    if (_shutdown) {
+        return false;
+    }
+    
+    // last writer wins, pending increments are overwritten as well
+    _lookup.assign(key.data(), key.length());
+    KeyEntry &entry = (*_keyMap)[_lookup];
+    entry.hasValue = true;
+    entry.value.assign(val.data(), val.length());
+    entry.delta = 0;
+    entry.hasDelta = false;
+
+    _received++;
+    _pendingOps++;
+    CheckFlushSize();
+    return true;
+}
+
+bool WriteCombiner::IncrBy(std::string_view key, long long delta)
+{
+    if (_shutdown) {
+        return false;
+    }
+
+    _lookup.assign(key.data(), key.length());
+    KeyEntry &entry = (*_keyMap)[_lookup];
+    entry.delta += delta;
+    entry.hasDelta = true;
+
+    _received++;
+    _pendingOps++;
+    CheckFlushSize();
+    return true;
+}
+
+bool WriteCombiner::HIncrBy(std::string_view key, std::string_view field, long long delta)
+{
+    if (_shutdown) {
+        return false;
+    }
+
+    _lookupField.first.assign(key.data(), key.length());
+    _lookupField.second.assign(field.data(), field.length());
+    (*_hashMap)[_lookupField] += delta;
+
+    _received++;
+    _pendingOps++;
+    CheckFlushSize();
+    return true;
+}
+
+// entries whose command fails stay pending for the next flush
+int WriteCombiner::Flush()
+{
+    //   AsyncCluster appends every command to the output buffer of its node, 
+    // so all the combined commands of one node leave in the same write once 
+    // the event loop runs.
+    int failed = 0;
+    uint64_t issued = _flushed;
+    _backoff = false;
+    char number[32];
+
+    KeyMap::iterator kit = _keyMap->begin();
+    while (kit != _keyMap->end()) {
+        std::string_view key(kit->first);
+        KeyEntry &entry = kit->second;
+
+        if (entry.hasValue) {
+            std::string_view argv[3] = { "SET", key, entry.value };
+            if (Issue(key, 3, argv)) {
+                entry.hasValue = false;
+                entry.value.clear();
+                _flushed++;
+            } else {
+                failed++;
+            }
+        }
+        // the increments apply on top of the SET, never before it
+        if (entry.hasDelta && !entry.hasValue) {
+            int len = snprintf(number, sizeof(number), "%lld", entry.delta);
+            std::string_view argv[3] = { "INCRBY", key, std::string_view(number, len) };
+            if (Issue(key, 3, argv)) {
+                entry.hasDelta = false;
+                entry.delta = 0;
+                _flushed++;
+            } else {
+                failed++;
+            }
+        }
+        if (entry.hasValue || entry.hasDelta) {
+            kit++;
+        } else {
+            kit = _keyMap->erase(kit);
+        }
+    }
+
+    HashMap::iterator hit = _hashMap->begin();
+    while (hit != _hashMap->end()) {
+        int len = snprintf(number, sizeof(number), "%lld", hit->second);
+        std::string_view argv[4] = { "HINCRBY", hit->first.first, hit->first.second, 
+                                     std::string_view(number, len) };
+        if (Issue(hit->first.first, 4, argv)) {
+            _flushed++;
+            hit = _hashMap->erase(hit);
+        } else {
+            failed++;
+            hit++;
+        }
+    }
+
+    //   What was saved is only known once everything received has been 
+    // issued, the pending entries may still take several flushes.
+    _issued += _flushed - issued;
+    if (GetPendingCount() == 0) {
+        _saved += _pendingOps - _issued;
+        _pendingOps = 0;
+        _issued = 0;
+    }
+    return failed;
+}
+
+void WriteCombiner::OnReady()
+{
+    if (_backoff && !_shutdown) {
+        _backoff = Flush() > 0;
+    }
+}
+
+void WriteCombiner::Shutdown()
+{
+    if (_shutdown) {
+        return;
+    }
+    _shutdown = true;
+
+    if (_timer) {
+        event_free(_timer);
+        _timer = NULL;
+    }
+    Flush();
+}
+
+/////////////////////// PRIVATE MEMBER FUNCTIONS ///////////////////////////////
+
+// formatted into an owned buffer, the entry is gone before the write
+bool WriteCombiner::Issue(std::string_view key, int argc, const std::string_view *argv)
+{
+    ArgvCommand argvCmd(argc, argv);
+    char *cmd = argvCmd.Format();
+    if (cmd == NULL) {
+        return false;
+    }
+    return _asyncCluster->FormattedCommand(key, _privdata, cmd, argvCmd.GetLength());
+}
+
+//   Entries that failed stay counted, retrying on every call would reissue 
+// the whole buffer per operation while the node is full.
+void WriteCombiner::CheckFlushSize()
+{
+    if (_flush_size > 0 && !_backoff && GetPendingCount() >= _flush_size) {
+        _backoff = Flush() > 0;
+    }
+}
+
+void WriteCombiner::OnFlushTimer(evutil_socket_t, short, void *arg)
+{
+    WriteCombiner *combiner = (WriteCombiner *)arg;
+    combiner->Flush();
+}
+
+} // RedisClusterAPI